@@ -0,0 +1,97 @@
+#include "aot.hpp"
+#include <algorithm>
+#include <iostream>
+
+// FNV-1a
+uint64_t AotHash(uint8_t const* data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+AotRunner::AotRunner(AotProgram const& program)
+    : program(program)
+{
+    std::fill(std::begin(lookup), std::end(lookup), -1);
+}
+
+bool AotRunner::Matches(Chip8 const& chip) const {
+    if (program.romSize > MEMORY_SIZE - START_ADDRESS) {
+        return false;
+    }
+    return AotHash(&chip.memory[START_ADDRESS], program.romSize) == program.romHash;
+}
+
+void AotRunner::Run(Chip8& chip, uint64_t cycles) {
+    if (chip.profiler || chip.tracer) {
+        chip.Run(cycles);
+        return;
+    }
+
+    // Stores made outside Step(), e.g. by chip.Run() in between, could
+    // have hit any block. Blocks only cover the ROM, so they are all
+    // still valid exactly when the ROM bytes still match the program.
+    bool loaded = owner != &chip || epoch != chip.codeEpoch;
+    if (loaded || flushed || writes != chip.memoryWrites) {
+        owner = &chip;
+        flushed = false;
+        epoch = chip.codeEpoch;
+        writes = chip.memoryWrites;
+        std::fill(std::begin(lookup), std::end(lookup), -1);
+
+        if (Matches(chip)) {
+            for (size_t i = 0; i < program.blockCount; ++i) {
+                lookup[program.blocks[i].start] = static_cast<int32_t>(i);
+            }
+        } else if (loaded) {
+            std::cerr << "WARNING: loaded ROM does not match the translated program, interpreting\n";
+        }
+    }
+
+    AotRegs regs{chip.hot.registers, chip.hot.index, chip.hot.pc};
+
+    while (cycles > 0) {
+        uint16_t pc = std::clamp(chip.hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+
+        int32_t id = lookup[pc];
+        if (id < 0 || program.blocks[id].length > cycles) {
+            Step(chip);
+            --cycles;
+            continue;
+        }
+
+        AotBlock const& block = program.blocks[id];
+        chip.hot.pc = pc;
+        block.func(regs);
+        cycles -= block.length;
+    }
+}
+
+void AotRunner::Step(Chip8& chip) {
+    uint16_t pc = std::clamp(chip.hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+    uint16_t opcode = (chip.memory[pc] << 8u) | chip.memory[pc + 1];
+    uint16_t index = chip.hot.index;
+
+    chip.Cycle();
+
+    uint16_t stored = Chip8::StoreLength(opcode);
+    if (stored > 0) {
+        Invalidate(index, stored);
+    }
+    writes = chip.memoryWrites;
+}
+
+// Self-modified code no longer matches its translation
+void AotRunner::Invalidate(uint16_t address, uint16_t length) {
+    unsigned int end = address + length;
+
+    for (size_t i = 0; i < program.blockCount; ++i) {
+        AotBlock const& block = program.blocks[i];
+        if (block.start < end && address < block.end && lookup[block.start] == static_cast<int32_t>(i)) {
+            lookup[block.start] = -1;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "chip.hpp"
+#include <cstddef>
+#include <cstdint>
+
+// Runtime for ROMs translated ahead of time by chip8-aot. The generated
+// translation unit defines one function per basic block and a table of
+// them; AotRunner executes those blocks on a regular Chip8 and steps
+// through the interpreter wherever no block was discovered.
+
+// Chip8 fields a translated block reads and writes
+struct AotRegs {
+    uint8_t* V;
+    uint16_t& I;
+    uint16_t& pc;
+};
+
+typedef void (*AotBlockFunc)(AotRegs& r);
+
+struct AotBlock {
+    uint16_t start;
+    uint16_t end;       // one past the last byte translated
+    uint32_t length;    // instructions executed per call
+    AotBlockFunc func;
+};
+
+struct AotProgram {
+    AotBlock const* blocks;
+    size_t blockCount;
+    uint32_t romSize;
+    uint64_t romHash;
+};
+
+uint64_t AotHash(uint8_t const* data, size_t size);
+
+class AotRunner {
+
+    public:
+        explicit AotRunner(AotProgram const& program);
+
+        void Run(Chip8& chip, uint64_t cycles);
+
+        // Revalidates the blocks on the next Run; call after copy-assigning
+        // into the machine this runner runs, as with Jit::Flush
+        void Flush() { flushed = true; }
+
+    private:
+        AotProgram const& program;
+        int32_t lookup[MEMORY_SIZE];
+        Chip8 const* owner{};
+        uint32_t epoch{};
+        uint32_t writes{};      // owner's memoryWrites already accounted for
+        bool flushed{};
+
+        bool Matches(Chip8 const& chip) const;
+        void Invalidate(uint16_t address, uint16_t length);
+        void Step(Chip8& chip);
+};
@@ -0,0 +1,200 @@
+#include "aot.hpp"
+#include "chip.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Reads a .ch8 file and writes a C++ translation unit defining
+// chip8AotProgram, for use with AotRunner.
+
+static std::string Hex(unsigned int value) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "0x%X", value);
+    return buffer;
+}
+
+static bool IsStraight(Op op) {
+    switch (op) {
+        case Op::Op6xkk: case Op::Op7xkk: case Op::OpAnnn:
+        case Op::Op8xy0: case Op::Op8xy1: case Op::Op8xy2: case Op::Op8xy3:
+        case Op::Op8xy4: case Op::Op8xy5: case Op::Op8xy6: case Op::Op8xy7: case Op::Op8xyE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool IsSkip(Op op) {
+    return op == Op::Op3xkk || op == Op::Op4xkk || op == Op::Op5xy0 || op == Op::Op9xy0;
+}
+
+// Same address rule as OP_1nnn
+static uint16_t JumpTarget(Instruction const& in, uint16_t next) {
+    return (in.nnn >= START_ADDRESS && in.nnn < 0xFFF) ? in.nnn : next + 2;
+}
+
+// C++ statement equivalent to the matching OP_* handler
+static std::string Statement(Instruction const& in, uint16_t next) {
+    std::string x = "r.V[" + Hex(in.x) + "]";
+    std::string y = "r.V[" + Hex(in.y) + "]";
+    std::string kk = Hex(in.kk);
+
+    switch (in.op) {
+        case Op::Op6xkk: return x + " = " + kk + ";";
+        case Op::Op7xkk: return x + " += " + kk + ";";
+        case Op::OpAnnn: return "r.I = " + Hex(in.nnn) + ";";
+        case Op::Op8xy0: return x + " = " + y + ";";
+        case Op::Op8xy1: return x + " |= " + y + ";";
+        case Op::Op8xy2: return x + " &= " + y + ";";
+        case Op::Op8xy3: return x + " ^= " + y + ";";
+        case Op::Op8xy4:
+            return "{ uint16_t sum = " + x + " + " + y + "; r.V[0xF] = sum > 255U; " + x + " = sum & 0xFFu; }";
+        case Op::Op8xy5: return "r.V[0xF] = " + x + " > " + y + "; " + x + " -= " + y + ";";
+        case Op::Op8xy6: return "r.V[0xF] = " + x + " & 0x1u; " + x + " >>= 1;";
+        case Op::Op8xy7: return "r.V[0xF] = " + y + " > " + x + "; " + x + " = " + y + " - " + x + ";";
+        case Op::Op8xyE: return "r.V[0xF] = (" + x + " & 0x80u) >> 7u; " + x + " <<= 1;";
+        case Op::Op1nnn: return "r.pc = " + Hex(JumpTarget(in, next)) + ";";
+        case Op::Op3xkk: return "r.pc = " + x + " == " + kk + " ? " + Hex(next + 2) + " : " + Hex(next) + ";";
+        case Op::Op4xkk: return "r.pc = " + x + " != " + kk + " ? " + Hex(next + 2) + " : " + Hex(next) + ";";
+        case Op::Op5xy0: return "r.pc = " + x + " == " + y + " ? " + Hex(next + 2) + " : " + Hex(next) + ";";
+        case Op::Op9xy0: return "r.pc = " + x + " != " + y + " ? " + Hex(next + 2) + " : " + Hex(next) + ";";
+        default: return "";
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <ROM> <Output.cpp>\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::ifstream file(argv[1], std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open ROM file\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<uint8_t> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (rom.empty() || rom.size() > MEMORY_SIZE - START_ADDRESS) {
+        std::cerr << "ERROR: ROM file is empty or too large\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    uint8_t memory[MEMORY_SIZE]{};
+    std::copy(rom.begin(), rom.end(), memory + START_ADDRESS);
+
+    auto decode = [&](uint16_t address) {
+        return Chip8::Decode((memory[address] << 8u) | memory[address + 1]);
+    };
+
+    // Follow every statically known control-flow edge from the entry point
+    std::set<uint16_t> starts;
+    std::set<uint16_t> visited;
+    std::vector<uint16_t> work{static_cast<uint16_t>(START_ADDRESS)};
+
+    while (!work.empty()) {
+        uint16_t address = work.back();
+        work.pop_back();
+
+        if (address < START_ADDRESS || address > MEMORY_SIZE - 2 || !starts.insert(address).second) {
+            continue;
+        }
+
+        while (address <= MEMORY_SIZE - 2 && visited.insert(address).second) {
+            Instruction in = decode(address);
+            uint16_t next = address + 2;
+
+            if (IsStraight(in.op)) {
+                address = next;
+                continue;
+            }
+
+            if (in.op == Op::Op1nnn) {
+                work.push_back(JumpTarget(in, next));
+            } else if (IsSkip(in.op)) {
+                work.push_back(next);
+                work.push_back(next + 2);
+            } else if (in.op == Op::Op2nnn) {
+                work.push_back(in.nnn);
+                work.push_back(next);
+            } else if (in.op != Op::Op00EE && in.op != Op::OpBnnn && in.op != Op::Invalid) {
+                // Interpreted instruction that falls through
+                work.push_back(next);
+            }
+            break;
+        }
+    }
+
+    std::ostringstream blocks;
+    std::ostringstream table;
+    size_t blockCount = 0;
+
+    for (uint16_t start : starts) {
+        std::ostringstream body;
+        uint16_t address = start;
+        uint32_t count = 0;
+        bool branched = false;
+
+        while (address <= MEMORY_SIZE - 2) {
+            Instruction in = decode(address);
+            uint16_t next = address + 2;
+
+            if (!IsStraight(in.op) && !IsSkip(in.op) && in.op != Op::Op1nnn) {
+                break;
+            }
+
+            body << "    " << Statement(in, next) << "\n";
+            ++count;
+            address = next;
+
+            if (!IsStraight(in.op)) {
+                branched = true;
+                break;
+            }
+        }
+
+        if (count == 0) {
+            continue;
+        }
+
+        if (!branched) {
+            body << "    r.pc = " << Hex(address) << ";\n";
+        }
+
+        std::string name = "Block" + Hex(start).substr(2);
+        blocks << "static void " << name << "(AotRegs& r) {\n"
+               << body.str()
+               << "}\n\n";
+        table << "    {" << Hex(start) << ", " << Hex(address) << ", " << count << ", " << name << "},\n";
+        ++blockCount;
+    }
+
+    std::ofstream out(argv[2]);
+    if (!out.is_open()) {
+        std::cerr << "ERROR: Failed to open output file\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    out << "// Generated by chip8-aot from " << argv[1] << ", do not edit.\n"
+        << "#include \"aot.hpp\"\n\n"
+        << blocks.str();
+
+    if (blockCount == 0) {
+        out << "static const AotBlock* const blocks = nullptr;\n\n";
+    } else {
+        out << "static const AotBlock blocks[] = {\n" << table.str() << "};\n\n";
+    }
+
+    out << "extern const AotProgram chip8AotProgram;\n"
+        << "const AotProgram chip8AotProgram = {blocks, " << blockCount << ", " << rom.size() << ", "
+        << AotHash(rom.data(), rom.size()) << "ull};\n";
+
+    std::cout << "Translated " << blockCount << " blocks from " << visited.size() << " reachable instructions\n";
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "aot.hpp"
+#include "chip.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Driver for executables built with chip8_add_aot_executable()
+extern const AotProgram chip8AotProgram;
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <ROM> <Cycles>\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    char const* romFilename = argv[1];
+    uint64_t cycles = std::stoull(argv[2]);
+
+    Chip8 chip8;
+    if (!chip8.LoadROM(romFilename)) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    AotRunner runner(chip8AotProgram);
+
+    auto start = std::chrono::steady_clock::now();
+
+    runner.Run(chip8, cycles);
+
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double ips = seconds > 0.0 ? cycles / seconds : 0.0;
+
+    std::cout << "cycles: " << cycles << "\n"
+              << "seconds: " << seconds << "\n"
+              << "instructions/sec: " << static_cast<uint64_t>(ips) << "\n";
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "audio.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// A transition more than this many frames off the audio clock means the
+// two have drifted apart (startup, a stall, fast-forward); the clock is
+// realigned to it rather than holding the sound back or playing it late
+// from then on
+const unsigned int RESYNC_FRAMES = 3;
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Buzzer::Buzzer(unsigned int sampleRate)
+    : sampleRate(sampleRate),
+      halfPeriod(std::max(1u, sampleRate / (2 * BUZZER_FREQUENCY)))
+{
+}
+
+void Buzzer::Update(uint64_t frame, bool newOn) {
+    if (newOn == lastOn) {
+        return;
+    }
+
+    if (queue.Push({frame, NowNs(), newOn})) {
+        lastOn = newOn;
+    } else {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Buzzer::Render(int16_t* samples, size_t count, double outputDelayMs) {
+    int64_t now = NowNs();
+    int64_t samplesPerFrame = sampleRate / FRAME_RATE;
+
+    for (size_t i = 0; i < count; ++i) {
+        for (auto* next = queue.Peek(); next; next = queue.Peek()) {
+            int64_t start = static_cast<int64_t>(next->frame * sampleRate / FRAME_RATE) - offset;
+            if (start > clock) {
+                if (start - clock <= samplesPerFrame * RESYNC_FRAMES) {
+                    break;
+                }
+                offset += start - clock;
+                start = clock;
+            }
+
+            if (clock - start >= samplesPerFrame) {
+                ++late;
+                if (clock - start > samplesPerFrame * RESYNC_FRAMES) {
+                    offset -= clock - start;
+                }
+            }
+
+            double latencyMs = (now - next->pushedNs) / 1e6 + i * 1000.0 / sampleRate + outputDelayMs;
+            latencySum += latencyMs;
+            latencyMax = std::max(latencyMax, latencyMs);
+            ++transitions;
+
+            on = next->on;
+            phase = 0;
+
+            Transition consumed;
+            queue.Pop(consumed);
+        }
+
+        if (on) {
+            samples[i] = phase < halfPeriod ? BUZZER_AMPLITUDE : -BUZZER_AMPLITUDE;
+            phase = phase + 1 < 2 * halfPeriod ? phase + 1 : 0;
+        } else {
+            samples[i] = 0;
+        }
+        ++clock;
+    }
+}
+
+AudioStats Buzzer::Stats() const {
+    return {transitions, dropped.load(std::memory_order_relaxed), late,
+            transitions > 0 ? latencySum / transitions : 0.0, latencyMax};
+}
+
+static void PutLE(uint8_t* out, uint32_t value, unsigned int bytes) {
+    for (unsigned int i = 0; i < bytes; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+bool WavWriter::Open(char const* filename, unsigned int sampleRate) {
+    Close();
+    file = fopen(filename, "wb");
+    if (!file) {
+        std::cerr << "ERROR: Failed to open " << filename << " for writing\n";
+        return false;
+    }
+
+    // RIFF header for 16-bit mono PCM; the two sizes are patched on Close()
+    uint8_t header[44] = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+                          'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0};
+    PutLE(header + 24, sampleRate, 4);
+    PutLE(header + 28, sampleRate * 2, 4);
+    PutLE(header + 32, 2, 2);
+    PutLE(header + 34, 16, 2);
+    memcpy(header + 36, "data", 4);
+
+    dataBytes = 0;
+    fwrite(header, 1, sizeof(header), file);
+    return true;
+}
+
+void WavWriter::Write(int16_t const* samples, size_t count) {
+    if (!file) {
+        return;
+    }
+
+    uint8_t bytes[1024];
+    for (size_t done = 0; done < count;) {
+        size_t chunk = std::min(count - done, sizeof(bytes) / 2);
+        for (size_t i = 0; i < chunk; ++i) {
+            PutLE(bytes + 2 * i, static_cast<uint16_t>(samples[done + i]), 2);
+        }
+        fwrite(bytes, 1, chunk * 2, file);
+        done += chunk;
+    }
+    dataBytes += static_cast<uint32_t>(count * 2);
+}
+
+void WavWriter::Close() {
+    if (!file) {
+        return;
+    }
+
+    uint8_t size[4];
+    PutLE(size, 36 + dataBytes, 4);
+    fseek(file, 4, SEEK_SET);
+    fwrite(size, 1, 4, file);
+
+    PutLE(size, dataBytes, 4);
+    fseek(file, 40, SEEK_SET);
+    fwrite(size, 1, 4, file);
+
+    fclose(file);
+    file = nullptr;
+}
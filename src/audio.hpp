@@ -0,0 +1,85 @@
+#pragma once
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+const unsigned int DEFAULT_SAMPLE_RATE = 48000;
+const unsigned int DEFAULT_AUDIO_BUFFER = 512;      // samples per device callback, ~10.7 ms at 48 kHz
+const unsigned int BUZZER_FREQUENCY = 440;
+const int16_t BUZZER_AMPLITUDE = 4000;
+const size_t AUDIO_QUEUE_SIZE = 256;                // transitions in flight
+
+struct AudioStats {
+    uint64_t transitions;   // on/off changes played
+    uint64_t dropped;       // lost to a full queue
+    uint64_t late;          // arrived after their frame had already played
+    double meanLatencyMs;   // from Update() to the sample leaving the device buffer
+    double maxLatencyMs;
+};
+
+// Square-wave buzzer driven by the sound timer. The emulation thread calls
+// Update() once per frame and the audio thread pulls samples with Render();
+// only on/off transitions cross between them, stamped with their frame,
+// through a lock-free queue. Render() starts each transition at the sample
+// where its frame begins, so a sound lasts exactly as many frames as the
+// timer said, and jumps ahead when the emulation runs ahead of the device.
+class Buzzer {
+
+    public:
+        explicit Buzzer(unsigned int sampleRate = DEFAULT_SAMPLE_RATE);
+
+        unsigned int SampleRate() const { return sampleRate; }
+
+        // Emulation thread. Never blocks; a transition that does not fit
+        // in the queue is dropped and counted.
+        void Update(uint64_t frame, bool on);
+
+        // Audio thread. outputDelayMs is how long a sample waits in the
+        // device after Render() returns it, for the latency figures.
+        void Render(int16_t* samples, size_t count, double outputDelayMs = 0.0);
+
+        // Only meaningful once the audio thread has stopped calling Render()
+        AudioStats Stats() const;
+
+    private:
+        struct Transition {
+            uint64_t frame;
+            int64_t pushedNs;       // steady clock at Update()
+            bool on;
+        };
+
+        unsigned int sampleRate;
+        SpscQueue<Transition, AUDIO_QUEUE_SIZE> queue;
+
+        // Emulation thread
+        bool lastOn{};
+        std::atomic<uint64_t> dropped{};
+
+        // Audio thread
+        int64_t clock{};            // samples rendered so far
+        int64_t offset{};           // frame timestamps to clock, moved on resync
+        bool on{};
+        uint32_t phase{};
+        uint32_t halfPeriod;        // samples per half square wave
+        uint64_t transitions{};
+        uint64_t late{};
+        double latencySum{};
+        double latencyMax{};
+};
+
+// 16-bit mono PCM .wav file, the headless audio sink
+class WavWriter {
+
+    public:
+        ~WavWriter() { Close(); }
+
+        bool Open(char const* filename, unsigned int sampleRate);
+        void Write(int16_t const* samples, size_t count);
+        void Close();    // fills in the header sizes
+
+    private:
+        FILE* file{};
+        uint32_t dataBytes{};
+};
@@ -0,0 +1,786 @@
+#include "batch.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CHIP8_BATCH_X86 1
+#include <immintrin.h>
+#endif
+
+const unsigned int BATCH_VECTOR = 32;         // uint8 lanes per AVX2 register
+
+// A step that splits into more groups than this means the lanes have
+// drifted apart; the rest of that Run() call executes lane by lane, and
+// the next call tries lockstep again
+const unsigned int MAX_GROUPS_PER_STEP = 4;
+
+const unsigned int PAGE_SHIFT = 6;            // 64 pages of 64 bytes
+const unsigned int PAGE_SIZE = 1u << PAGE_SHIFT;
+
+// First lane at or after lane with a non-zero mask entry, or count.
+// Masks are scanned eight bytes at a time, so sparse groups are cheap.
+template <typename T>
+static unsigned int NextSet(T const* mask, unsigned int lane, unsigned int count) {
+    const unsigned int PER_WORD = sizeof(uint64_t) / sizeof(T);
+
+    while (lane < count) {
+        if (lane % PER_WORD == 0 && lane + PER_WORD <= count) {
+            uint64_t word;
+            memcpy(&word, mask + lane, sizeof(word));
+            if (word == 0) {
+                lane += PER_WORD;
+                continue;
+            }
+        }
+        if (mask[lane]) {
+            return lane;
+        }
+        ++lane;
+    }
+    return count;
+}
+
+template <typename T, typename F>
+static void ForEachSet(T const* mask, unsigned int first, unsigned int count, F f) {
+    for (unsigned int lane = NextSet(mask, first, count); lane < count; lane = NextSet(mask, lane + 1, count)) {
+        f(lane);
+    }
+}
+
+Chip8Batch::Chip8Batch(unsigned int laneCount)
+    : lanes(std::max(1u, laneCount))
+    , stride((lanes + BATCH_VECTOR - 1) / BATCH_VECTOR * BATCH_VECTOR)
+{
+    V.assign(REGISTER_COUNT * stride, 0);
+    pc.assign(stride, START_ADDRESS);
+    index.assign(stride, 0);
+    sp.assign(stride, 0);
+    delayTimer.assign(stride, 0);
+    soundTimer.assign(stride, 0);
+    keys.assign(stride, 0);
+
+    memory.assign(lanes * LANE_MEMORY, 0);
+    stack.assign(lanes * STACK_LEVELS, 0);
+    video.assign(lanes * VIDEO_HEIGHT, 0);
+    randState.assign(lanes, 1);
+    invalidCount.assign(lanes, 0);
+    dirtyRows.assign(lanes, ~0u);
+    drawFlag.assign(lanes, 0);
+    diagnostics.assign(lanes * DIAG_COUNT, 0);
+
+    opcodes.assign(stride, 0);
+    fetched.assign(stride, Instruction{});
+    pending16.assign(stride, 0);
+    mask8.assign(stride, 0);
+    mask16.assign(stride, 0);
+
+    code.assign(MEMORY_SIZE, 0);
+    codeDecoded.assign(MEMORY_SIZE, Instruction{});
+    dirtyPages.assign(lanes, 0);
+    allLanes8.assign(stride, 0);
+    allLanes16.assign(stride, 0);
+    std::fill(allLanes8.begin(), allLanes8.begin() + lanes, 0xFF);
+    std::fill(allLanes16.begin(), allLanes16.begin() + lanes, 0xFFFF);
+
+    // Every lane starts out as a freshly constructed Chip8
+    Chip8 blank;
+    Chip8State state;
+    blank.SaveState(state);
+
+    SetCode(state.memory);
+
+    uint64_t clock = std::chrono::system_clock::now().time_since_epoch().count();
+    for (unsigned int lane = 0; lane < lanes; ++lane) {
+        LoadState(lane, state);
+        drawFlag[lane] = 0;
+        Seed(lane, clock + lane);
+    }
+
+#if defined(CHIP8_BATCH_X86)
+    __builtin_cpu_init();
+    avx2 = __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool Chip8Batch::LoadROM(uint8_t const* data, size_t size) {
+    if (size == 0) {
+        std::cerr << "ERROR: ROM is empty\n";
+        return false;
+    }
+
+    if (size > (MEMORY_SIZE - START_ADDRESS)) {
+        std::cerr << "WARNING: ROM size (" << size << " bytes) exceeds available memory ("
+                  << (MEMORY_SIZE - START_ADDRESS) << " bytes)\n";
+    }
+
+    size_t count = std::min<size_t>(size, MEMORY_SIZE - START_ADDRESS);
+    for (unsigned int lane = 0; lane < lanes; ++lane) {
+        memcpy(&memory[lane * LANE_MEMORY + START_ADDRESS], data, count);
+    }
+
+    SetCode(&memory[0]);
+    return true;
+}
+
+// Makes image the shared program and works out which pages of each lane
+// already differ from it
+void Chip8Batch::SetCode(uint8_t const* image) {
+    memcpy(code.data(), image, MEMORY_SIZE);
+
+    for (unsigned int address = 0; address + 1 < MEMORY_SIZE; ++address) {
+        codeDecoded[address] = Chip8::Decode(static_cast<uint16_t>((code[address] << 8u) | code[address + 1]));
+    }
+
+    anyDirty = 0;
+    for (unsigned int lane = 0; lane < lanes; ++lane) {
+        dirtyPages[lane] = 0;
+        for (unsigned int page = 0; page < MEMORY_SIZE / PAGE_SIZE; ++page) {
+            if (memcmp(&memory[lane * LANE_MEMORY + page * PAGE_SIZE], &code[page * PAGE_SIZE], PAGE_SIZE) != 0) {
+                dirtyPages[lane] |= 1ull << page;
+            }
+        }
+        anyDirty |= dirtyPages[lane];
+    }
+}
+
+void Chip8Batch::MarkDirty(unsigned int lane, unsigned int address, unsigned int length) {
+    for (unsigned int page = address >> PAGE_SHIFT; page <= (address + length - 1) >> PAGE_SHIFT; ++page) {
+        dirtyPages[lane] |= 1ull << page;
+    }
+    anyDirty |= dirtyPages[lane];
+}
+
+// A lane and a scalar machine given the same seed draw the same numbers
+void Chip8Batch::Seed(unsigned int lane, uint64_t seed) {
+    randState[lane] = Chip8::SeedState(seed);
+}
+
+void Chip8Batch::SetKeys(unsigned int lane, uint16_t mask) {
+    keys[lane] = mask;
+}
+
+void Chip8Batch::SaveState(unsigned int lane, Chip8State& state) const {
+    state.magic = STATE_MAGIC;
+    state.version = STATE_VERSION;
+    state.keys = keys[lane];
+    state.randState = randState[lane];
+    memcpy(state.video, &video[lane * VIDEO_HEIGHT], sizeof(state.video));
+    state.index = index[lane];
+    state.pc = pc[lane];
+    memcpy(state.stack, &stack[lane * STACK_LEVELS], sizeof(state.stack));
+    state.sp = sp[lane];
+    state.delayTimer = delayTimer[lane];
+    state.soundTimer = soundTimer[lane];
+    state.invalidCount = invalidCount[lane];
+    for (unsigned int r = 0; r < REGISTER_COUNT; ++r) {
+        state.registers[r] = V[r * stride + lane];
+    }
+    memcpy(state.memory, &memory[lane * LANE_MEMORY], sizeof(state.memory));
+}
+
+bool Chip8Batch::LoadState(unsigned int lane, Chip8State const& state) {
+    if (state.magic != STATE_MAGIC || state.version != STATE_VERSION) {
+        std::cerr << "ERROR: Unsupported save state (version " << state.version << ")\n";
+        return false;
+    }
+
+    keys[lane] = state.keys;
+    randState[lane] = state.randState != 0 ? state.randState : 1;
+    memcpy(&video[lane * VIDEO_HEIGHT], state.video, sizeof(state.video));
+    index[lane] = state.index;
+    pc[lane] = state.pc;
+    memcpy(&stack[lane * STACK_LEVELS], state.stack, sizeof(state.stack));
+    sp[lane] = state.sp <= STACK_LEVELS ? state.sp : 0;
+    delayTimer[lane] = state.delayTimer;
+    soundTimer[lane] = state.soundTimer;
+    invalidCount[lane] = state.invalidCount;
+    for (unsigned int r = 0; r < REGISTER_COUNT; ++r) {
+        V[r * stride + lane] = state.registers[r];
+    }
+    memcpy(&memory[lane * LANE_MEMORY], state.memory, sizeof(state.memory));
+
+    // anyDirty only ever grows here; SetCode recomputes it exactly
+    dirtyPages[lane] = 0;
+    for (unsigned int page = 0; page < MEMORY_SIZE / PAGE_SIZE; ++page) {
+        if (memcmp(&state.memory[page * PAGE_SIZE], &code[page * PAGE_SIZE], PAGE_SIZE) != 0) {
+            dirtyPages[lane] |= 1ull << page;
+        }
+    }
+    anyDirty |= dirtyPages[lane];
+
+    dirtyRows[lane] = ~0u;
+    drawFlag[lane] = 1;
+    return true;
+}
+
+uint64_t Chip8Batch::StateHash(unsigned int lane) const {
+    Chip8State state;
+    SaveState(lane, state);
+    return Chip8::HashState(state);
+}
+
+void Chip8Batch::TickTimers() {
+    for (unsigned int lane = 0; lane < lanes; ++lane) {
+        delayTimer[lane] -= delayTimer[lane] > 0;
+        soundTimer[lane] -= soundTimer[lane] > 0;
+    }
+}
+
+void Chip8Batch::Run(uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; ++i) {
+        if (!Step()) {
+            RunLanes(cycles - i - 1);
+            return;
+        }
+    }
+}
+
+// One instruction on every lane; false if the lanes were too divergent
+// for lockstep to pay off
+bool Chip8Batch::Step() {
+    ++steps;
+
+    Instruction shared;
+    if (FetchShared(shared)) {
+        ++groups;
+        if (!avx2 || !ExecuteAVX2(shared, allLanes8.data(), allLanes16.data())) {
+            for (unsigned int lane = 0; lane < lanes; ++lane) {
+                ExecuteLane(lane, shared);
+            }
+        }
+        return true;
+    }
+
+    for (unsigned int lane = 0; lane < lanes; ++lane) {
+        fetched[lane] = FetchLane(lane);
+        opcodes[lane] = fetched[lane].opcode;
+        pending16[lane] = 0xFFFF;
+    }
+
+    unsigned int first = 0;
+    unsigned int groupCount = 0;
+
+    while ((first = NextSet(pending16.data(), first, lanes)) < lanes) {
+        if (groupCount == MAX_GROUPS_PER_STEP) {
+            ForEachSet(pending16.data(), first, lanes, [&](unsigned int lane) {
+                ExecuteLane(lane, fetched[lane]);
+                ++groups;
+            });
+            return false;
+        }
+
+        Instruction in = fetched[first];
+        unsigned int count = avx2 ? GroupAVX2(in.opcode) : Group(in.opcode);
+        ++groupCount;
+        ++groups;
+
+        // The leader is always the lowest lane of its group
+        if (count == 1) {
+            ExecuteLane(first, in);
+        } else if (!avx2 || !ExecuteAVX2(in, mask8.data(), mask16.data())) {
+            ForEachSet(mask8.data(), first, lanes, [&](unsigned int lane) { ExecuteLane(lane, in); });
+        }
+    }
+    return true;
+}
+
+// Lanes are independent, so running each one on its own for the rest of
+// the call ends in the same state as lockstep would
+void Chip8Batch::RunLanes(uint64_t cycles) {
+    for (unsigned int lane = 0; lane < lanes; ++lane) {
+        for (uint64_t i = 0; i < cycles; ++i) {
+            ExecuteLane(lane, FetchLane(lane));
+        }
+    }
+    steps += cycles;
+    groups += cycles * lanes;
+}
+
+// The common case: all lanes at one PC in code none of them has changed
+bool Chip8Batch::FetchShared(Instruction& in) {
+    uint16_t first = pc[0];
+    if (!(avx2 ? SamePcAVX2(first) : SamePc(first))) {
+        return false;
+    }
+
+    uint16_t address = std::clamp(first, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+    uint64_t pages = (1ull << (address >> PAGE_SHIFT)) | (1ull << ((address + 1u) >> PAGE_SHIFT));
+    if (anyDirty & pages) {
+        return false;
+    }
+
+    std::fill(pc.begin(), pc.end(), static_cast<uint16_t>(address + 2));
+    in = codeDecoded[address];
+    return true;
+}
+
+bool Chip8Batch::SamePc(uint16_t value) const {
+    for (unsigned int lane = 1; lane < lanes; ++lane) {
+        if (pc[lane] != value) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Clamps, fetches and advances PC like Chip8::CycleSwitch. Lanes running
+// unmodified code take the pre-decoded instruction.
+Instruction Chip8Batch::FetchLane(unsigned int lane) {
+    uint16_t address = std::clamp(pc[lane], static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+    uint64_t pages = (1ull << (address >> PAGE_SHIFT)) | (1ull << ((address + 1u) >> PAGE_SHIFT));
+    pc[lane] = address + 2;
+
+    if (dirtyPages[lane] & pages) {
+        uint8_t const* bytes = &memory[lane * LANE_MEMORY + address];
+        return Chip8::Decode(static_cast<uint16_t>((bytes[0] << 8u) | bytes[1]));
+    }
+    return codeDecoded[address];
+}
+
+// Selects the pending lanes about to execute opcode; returns how many
+unsigned int Chip8Batch::Group(uint16_t opcode) {
+    unsigned int count = 0;
+
+    for (unsigned int lane = 0; lane < stride; ++lane) {
+        bool member = pending16[lane] && opcodes[lane] == opcode;
+        mask8[lane] = member ? 0xFF : 0;
+        mask16[lane] = member ? 0xFFFF : 0;
+        pending16[lane] &= ~mask16[lane];
+        count += member;
+    }
+    return count;
+}
+
+void Chip8Batch::Report(unsigned int lane, Diag diag, uint16_t a, uint16_t b) {
+    ++diagnostics[lane * DIAG_COUNT + static_cast<unsigned int>(diag)];
+    Logger::Instance().Report(diag, a, b);
+}
+
+void Chip8Batch::ResetLane(unsigned int lane) {
+    pc[lane] = START_ADDRESS;
+    sp[lane] = 0;
+    index[lane] = 0;
+    for (unsigned int r = 0; r < REGISTER_COUNT; ++r) {
+        V[r * stride + lane] = 0;
+    }
+    memset(&stack[lane * STACK_LEVELS], 0, STACK_LEVELS * sizeof(uint16_t));
+}
+
+// One instruction on one lane; mirrors the Chip8 handlers exactly
+void Chip8Batch::ExecuteLane(unsigned int lane, Instruction const& in) {
+    // Locals rather than members: every byte store may alias a member,
+    // which would force a reload of stride and the vector pointers
+    uint8_t* registers = &V[lane];
+    unsigned int step = stride;
+    auto reg = [registers, step](unsigned int r) -> uint8_t& { return registers[r * step]; };
+    uint8_t* mem = &memory[lane * LANE_MEMORY];
+    uint16_t* stk = &stack[lane * STACK_LEVELS];
+    uint64_t* rows = &video[lane * VIDEO_HEIGHT];
+    uint16_t& PC = pc[lane];
+    uint16_t& I = index[lane];
+
+    switch (in.op) {
+        case Op::Op00E0:
+            memset(rows, 0, VIDEO_HEIGHT * sizeof(uint64_t));
+            dirtyRows[lane] = ~0u;
+            break;
+        case Op::Op00EE:
+            if (sp[lane] == 0) {
+                Report(lane, Diag::StackUnderflow, PC - 2);
+                ResetLane(lane);
+                break;
+            }
+            --sp[lane];
+            PC = stk[sp[lane]];
+            break;
+        case Op::Op1nnn:
+            if (in.nnn >= 0x200 && in.nnn < 0xFFF) {
+                PC = in.nnn;
+            } else {
+                PC += 2;
+            }
+            break;
+        case Op::Op2nnn:
+            if (sp[lane] >= STACK_LEVELS) {
+                Report(lane, Diag::StackOverflow, PC - 2);
+                ResetLane(lane);
+                break;
+            }
+            stk[sp[lane]] = PC;
+            ++sp[lane];
+            PC = in.nnn;
+            break;
+        case Op::Op3xkk: PC += reg(in.x) == in.kk ? 2 : 0; break;
+        case Op::Op4xkk: PC += reg(in.x) != in.kk ? 2 : 0; break;
+        case Op::Op5xy0: PC += reg(in.x) == reg(in.y) ? 2 : 0; break;
+        case Op::Op6xkk: reg(in.x) = in.kk; break;
+        case Op::Op7xkk: reg(in.x) += in.kk; break;
+        case Op::Op8xy0: reg(in.x) = reg(in.y); break;
+        case Op::Op8xy1: reg(in.x) |= reg(in.y); break;
+        case Op::Op8xy2: reg(in.x) &= reg(in.y); break;
+        case Op::Op8xy3: reg(in.x) ^= reg(in.y); break;
+        case Op::Op8xy4: {
+            uint16_t sum = reg(in.x) + reg(in.y);
+            reg(0xF) = sum > 255u;
+            reg(in.x) = sum & 0xFFu;
+            break;
+        }
+        case Op::Op8xy5:
+            reg(0xF) = reg(in.x) > reg(in.y);
+            reg(in.x) -= reg(in.y);
+            break;
+        case Op::Op8xy6:
+            reg(0xF) = reg(in.x) & 0x1u;
+            reg(in.x) >>= 1;
+            break;
+        case Op::Op8xy7:
+            reg(0xF) = reg(in.y) > reg(in.x);
+            reg(in.x) = reg(in.y) - reg(in.x);
+            break;
+        case Op::Op8xyE:
+            reg(0xF) = (reg(in.x) & 0x80u) >> 7u;
+            reg(in.x) <<= 1;
+            break;
+        case Op::Op9xy0: PC += reg(in.x) != reg(in.y) ? 2 : 0; break;
+        case Op::OpAnnn: I = in.nnn; break;
+        case Op::OpBnnn: PC = in.nnn + reg(0); break;
+        case Op::OpCxkk: {
+            uint64_t& state = randState[lane];
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            reg(in.x) = static_cast<uint8_t>((state * 2685821657736338717ull) >> 56) & in.kk;
+            break;
+        }
+        case Op::OpDxyn: {
+            uint8_t height = in.kk & 0x000Fu;
+            if (I + height >= MEMORY_SIZE) {
+                Report(lane, Diag::SpriteOutOfBounds, I);
+                break;
+            }
+
+            uint8_t xPos = reg(in.x) % VIDEO_WIDTH;
+            uint8_t yPos = reg(in.y) % VIDEO_HEIGHT;
+            reg(0xF) = 0;
+            bool pixelChanged = false;
+
+            for (unsigned int row = 0; row < height && yPos + row < VIDEO_HEIGHT; ++row) {
+                uint64_t spriteRow = (static_cast<uint64_t>(mem[I + row]) << 56u) >> xPos;
+                uint64_t& screenRow = rows[yPos + row];
+
+                if (screenRow & spriteRow) {
+                    reg(0xF) = 1;
+                }
+                screenRow ^= spriteRow;
+
+                if (spriteRow) {
+                    dirtyRows[lane] |= 1u << (yPos + row);
+                    pixelChanged = true;
+                }
+            }
+            drawFlag[lane] = pixelChanged;
+            break;
+        }
+        case Op::OpEx9E: {
+            uint8_t key = reg(in.x);
+            PC += key < KEY_COUNT && ((keys[lane] >> key) & 1u) ? 2 : 0;
+            break;
+        }
+        case Op::OpExA1: {
+            uint8_t key = reg(in.x);
+            PC += key >= KEY_COUNT || !((keys[lane] >> key) & 1u) ? 2 : 0;
+            break;
+        }
+        case Op::OpFx07: reg(in.x) = delayTimer[lane]; break;
+        case Op::OpFx0A:
+            if (keys[lane]) {
+                reg(in.x) = static_cast<uint8_t>(__builtin_ctz(keys[lane]));
+            } else {
+                PC -= 2;
+            }
+            break;
+        case Op::OpFx15: delayTimer[lane] = reg(in.x); break;
+        case Op::OpFx18: soundTimer[lane] = reg(in.x); break;
+        case Op::OpFx1E: {
+            uint16_t oldIndex = I;
+            I += reg(in.x);
+            if (I < oldIndex || I >= MEMORY_SIZE) {
+                Report(lane, Diag::IndexOverflow, I);
+                I %= MEMORY_SIZE;
+            }
+            if (I < FONTSET_START_ADDRESS) {
+                I = FONTSET_START_ADDRESS;
+            }
+            break;
+        }
+        case Op::OpFx29: I = FONTSET_START_ADDRESS + 5 * (reg(in.x) & 0x0F); break;
+        case Op::OpFx33: {
+            if (I + 2u >= MEMORY_SIZE) {
+                Report(lane, Diag::StoreOutOfBounds, I);
+                break;
+            }
+            uint8_t value = reg(in.x);
+            mem[I + 2] = value % 10;
+            mem[I + 1] = (value / 10) % 10;
+            mem[I] = value / 100;
+            MarkDirty(lane, I, 3);
+            break;
+        }
+        case Op::OpFx55:
+            if (I + in.x >= MEMORY_SIZE) {
+                Report(lane, Diag::StoreOutOfBounds, I);
+                break;
+            }
+            for (unsigned int r = 0; r <= in.x; ++r) {
+                mem[I + r] = reg(r);
+            }
+            MarkDirty(lane, I, in.x + 1);
+            break;
+        case Op::OpFx65:
+            if (I + in.x >= MEMORY_SIZE) {
+                Report(lane, Diag::LoadOutOfBounds, I);
+                break;
+            }
+            for (unsigned int r = 0; r <= in.x; ++r) {
+                reg(r) = mem[I + r];
+            }
+            break;
+        case Op::Invalid:
+            Report(lane, Diag::InvalidOpcode, in.opcode, PC - 2);
+            PC = START_ADDRESS;
+            break;
+        case Op::Null:
+            if (++invalidCount[lane] > 10) {
+                Report(lane, Diag::TooManyInvalidOps);
+                ResetLane(lane);
+                invalidCount[lane] = 0;
+            }
+            break;
+    }
+}
+
+#if defined(CHIP8_BATCH_X86)
+
+__attribute__((target("avx2")))
+static inline __m256i Load(void const* p) {
+    return _mm256_loadu_si256(static_cast<__m256i const*>(p));
+}
+
+__attribute__((target("avx2")))
+static inline void StoreMasked(void* p, __m256i value, __m256i mask) {
+    _mm256_storeu_si256(static_cast<__m256i*>(p), _mm256_blendv_epi8(Load(p), value, mask));
+}
+
+// Unsigned a > b per byte, as 0xFF / 0x00
+__attribute__((target("avx2")))
+static inline __m256i GreaterU8(__m256i a, __m256i b) {
+    return _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b), _mm256_set1_epi8(-1));
+}
+
+// Adds 2 to the PCs of the 32 lanes whose byte condition is set
+__attribute__((target("avx2")))
+static inline void SkipIf(uint16_t* pc, __m256i condition) {
+    __m256i two = _mm256_set1_epi16(2);
+    __m256i low = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(condition));
+    __m256i high = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(condition, 1));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pc), _mm256_add_epi16(Load(pc), _mm256_and_si256(low, two)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pc + 16), _mm256_add_epi16(Load(pc + 16), _mm256_and_si256(high, two)));
+}
+
+__attribute__((target("avx2")))
+bool Chip8Batch::SamePcAVX2(uint16_t value) const {
+    __m256i target = _mm256_set1_epi16(static_cast<short>(value));
+    __m256i differ = _mm256_setzero_si256();
+
+    for (unsigned int b = 0; b < stride; b += 16) {
+        __m256i mismatch = _mm256_xor_si256(Load(&pc[b]), target);
+        differ = _mm256_or_si256(differ, _mm256_and_si256(mismatch, Load(&allLanes16[b])));
+    }
+    return _mm256_testz_si256(differ, differ);
+}
+
+__attribute__((target("avx2")))
+unsigned int Chip8Batch::GroupAVX2(uint16_t opcode) {
+    __m256i target = _mm256_set1_epi16(static_cast<short>(opcode));
+    unsigned int count = 0;
+
+    for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+        __m256i pending0 = Load(&pending16[b]);
+        __m256i pending1 = Load(&pending16[b + 16]);
+        __m256i member0 = _mm256_and_si256(_mm256_cmpeq_epi16(Load(&opcodes[b]), target), pending0);
+        __m256i member1 = _mm256_and_si256(_mm256_cmpeq_epi16(Load(&opcodes[b + 16]), target), pending1);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&mask16[b]), member0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&mask16[b + 16]), member1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&pending16[b]), _mm256_andnot_si256(member0, pending0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&pending16[b + 16]), _mm256_andnot_si256(member1, pending1));
+
+        // packs works within 128-bit halves; the permute restores lane order
+        __m256i member8 = _mm256_permute4x64_epi64(_mm256_packs_epi16(member0, member1), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(&mask8[b]), member8);
+        count += __builtin_popcount(static_cast<uint32_t>(_mm256_movemask_epi8(member8)));
+    }
+    return count;
+}
+
+// The group's opcode on all of its lanes at once. Handlers that touch
+// per-lane memory, the stack, video or the RNG return false and run lane
+// by lane instead. Stores follow the scalar handler's order, so x == F
+// and x == y behave the same.
+__attribute__((target("avx2")))
+bool Chip8Batch::ExecuteAVX2(Instruction const& in, uint8_t const* mask8, uint16_t const* mask16) {
+    uint8_t* vx = &V[in.x * stride];
+    uint8_t* vy = &V[in.y * stride];
+    uint8_t* vf = &V[0xF * stride];
+    __m256i ones = _mm256_set1_epi8(-1);
+    __m256i one = _mm256_set1_epi8(1);
+    __m256i kk = _mm256_set1_epi8(static_cast<char>(in.kk));
+
+    switch (in.op) {
+        case Op::Op3xkk:
+        case Op::Op4xkk:
+        case Op::Op5xy0:
+        case Op::Op9xy0:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                bool immediate = in.op == Op::Op3xkk || in.op == Op::Op4xkk;
+                __m256i equal = _mm256_cmpeq_epi8(Load(vx + b), immediate ? kk : Load(vy + b));
+                if (in.op == Op::Op4xkk || in.op == Op::Op9xy0) {
+                    equal = _mm256_xor_si256(equal, ones);
+                }
+                SkipIf(&pc[b], _mm256_and_si256(equal, Load(mask8 + b)));
+            }
+            return true;
+        case Op::Op6xkk:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                StoreMasked(vx + b, kk, Load(mask8 + b));
+            }
+            return true;
+        case Op::Op7xkk:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                StoreMasked(vx + b, _mm256_add_epi8(Load(vx + b), kk), Load(mask8 + b));
+            }
+            return true;
+        case Op::Op8xy0:
+        case Op::Op8xy1:
+        case Op::Op8xy2:
+        case Op::Op8xy3:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                __m256i a = Load(vx + b);
+                __m256i c = Load(vy + b);
+                __m256i result = in.op == Op::Op8xy0 ? c
+                               : in.op == Op::Op8xy1 ? _mm256_or_si256(a, c)
+                               : in.op == Op::Op8xy2 ? _mm256_and_si256(a, c)
+                               : _mm256_xor_si256(a, c);
+                StoreMasked(vx + b, result, Load(mask8 + b));
+            }
+            return true;
+        case Op::Op8xy4:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                __m256i mask = Load(mask8 + b);
+                __m256i a = Load(vx + b);
+                __m256i c = Load(vy + b);
+                __m256i carry = GreaterU8(a, _mm256_xor_si256(c, ones));
+                StoreMasked(vf + b, _mm256_and_si256(carry, one), mask);
+                StoreMasked(vx + b, _mm256_add_epi8(a, c), mask);
+            }
+            return true;
+        case Op::Op8xy5:
+        case Op::Op8xy7:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                __m256i mask = Load(mask8 + b);
+                bool reverse = in.op == Op::Op8xy7;
+                __m256i a = Load(vx + b);
+                __m256i c = Load(vy + b);
+                __m256i noBorrow = reverse ? GreaterU8(c, a) : GreaterU8(a, c);
+                StoreMasked(vf + b, _mm256_and_si256(noBorrow, one), mask);
+
+                a = Load(vx + b);
+                c = Load(vy + b);
+                StoreMasked(vx + b, reverse ? _mm256_sub_epi8(c, a) : _mm256_sub_epi8(a, c), mask);
+            }
+            return true;
+        case Op::Op8xy6:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                __m256i mask = Load(mask8 + b);
+                StoreMasked(vf + b, _mm256_and_si256(Load(vx + b), one), mask);
+                __m256i shifted = _mm256_and_si256(_mm256_srli_epi16(Load(vx + b), 1), _mm256_set1_epi8(0x7F));
+                StoreMasked(vx + b, shifted, mask);
+            }
+            return true;
+        case Op::Op8xyE:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                __m256i mask = Load(mask8 + b);
+                StoreMasked(vf + b, _mm256_and_si256(_mm256_srli_epi16(Load(vx + b), 7), one), mask);
+                __m256i a = Load(vx + b);
+                StoreMasked(vx + b, _mm256_add_epi8(a, a), mask);
+            }
+            return true;
+        case Op::OpFx07:
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                StoreMasked(vx + b, Load(&delayTimer[b]), Load(mask8 + b));
+            }
+            return true;
+        case Op::OpFx15:
+        case Op::OpFx18: {
+            uint8_t* timer = in.op == Op::OpFx15 ? delayTimer.data() : soundTimer.data();
+            for (unsigned int b = 0; b < stride; b += BATCH_VECTOR) {
+                StoreMasked(timer + b, Load(vx + b), Load(mask8 + b));
+            }
+            return true;
+        }
+        case Op::Op1nnn: {
+            bool valid = in.nnn >= 0x200 && in.nnn < 0xFFF;
+            __m256i target = _mm256_set1_epi16(static_cast<short>(in.nnn));
+            for (unsigned int b = 0; b < stride; b += 16) {
+                __m256i next = valid ? target : _mm256_add_epi16(Load(&pc[b]), _mm256_set1_epi16(2));
+                StoreMasked(&pc[b], next, Load(mask16 + b));
+            }
+            return true;
+        }
+        case Op::OpAnnn: {
+            __m256i address = _mm256_set1_epi16(static_cast<short>(in.nnn));
+            for (unsigned int b = 0; b < stride; b += 16) {
+                StoreMasked(&index[b], address, Load(mask16 + b));
+            }
+            return true;
+        }
+        case Op::OpBnnn: {
+            __m256i address = _mm256_set1_epi16(static_cast<short>(in.nnn));
+            for (unsigned int b = 0; b < stride; b += 16) {
+                __m256i v0 = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(&V[b])));
+                StoreMasked(&pc[b], _mm256_add_epi16(address, v0), Load(mask16 + b));
+            }
+            return true;
+        }
+        case Op::OpFx29:
+            for (unsigned int b = 0; b < stride; b += 16) {
+                __m256i digit = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<__m128i const*>(vx + b)));
+                digit = _mm256_and_si256(digit, _mm256_set1_epi16(0x0F));
+                __m256i address = _mm256_add_epi16(_mm256_mullo_epi16(digit, _mm256_set1_epi16(5)),
+                                                   _mm256_set1_epi16(FONTSET_START_ADDRESS));
+                StoreMasked(&index[b], address, Load(mask16 + b));
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+#else
+
+bool Chip8Batch::SamePcAVX2(uint16_t value) const {
+    return SamePc(value);
+}
+
+unsigned int Chip8Batch::GroupAVX2(uint16_t opcode) {
+    return Group(opcode);
+}
+
+bool Chip8Batch::ExecuteAVX2(Instruction const&, uint8_t const*, uint16_t const*) {
+    return false;
+}
+
+#endif
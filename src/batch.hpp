@@ -0,0 +1,112 @@
+#pragma once
+#include "chip.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Each lane's memory is padded by a cache line so the same address in
+// different lanes does not map to the same L1 set
+const unsigned int LANE_MEMORY = MEMORY_SIZE + 64;
+
+// Many machines stepped in lockstep, one instruction per lane per step.
+// Registers, PC, I, SP, timers and keys are stored structure-of-arrays
+// (V[r][lane]) so that lanes fetching the same opcode can execute it with
+// one vector operation; memory, stack and video stay per lane. Lanes that
+// diverge are regrouped by opcode each step, and each group executes with
+// the other lanes masked off. Every lane ends in exactly the state a
+// scalar Chip8 would reach after the same instructions.
+//
+// While every lane is at the same PC and no lane has stored into the
+// 64-byte page it is fetching from, the opcode is read once from a shared
+// copy of the loaded program instead of once per lane.
+class Chip8Batch {
+
+    public:
+        explicit Chip8Batch(unsigned int lanes);
+
+        unsigned int Lanes() const { return lanes; }
+
+        // Loads the same ROM into every lane
+        bool LoadROM(uint8_t const* data, size_t size);
+        void Seed(unsigned int lane, uint64_t seed);
+        void SetKeys(unsigned int lane, uint16_t mask);   // bit n = key n held
+
+        // Every lane executes exactly cycles instructions
+        void Run(uint64_t cycles);
+        void TickTimers();
+
+        void SaveState(unsigned int lane, Chip8State& state) const;
+        bool LoadState(unsigned int lane, Chip8State const& state);
+        uint64_t StateHash(unsigned int lane) const;
+
+        uint64_t const* Video(unsigned int lane) const { return &video[lane * VIDEO_HEIGHT]; }
+        uint8_t const* Memory(unsigned int lane) const { return &memory[lane * LANE_MEMORY]; }
+        uint32_t& DirtyRows(unsigned int lane) { return dirtyRows[lane]; }
+        bool DrawFlag(unsigned int lane) const { return drawFlag[lane] != 0; }
+        uint64_t Diagnostics(unsigned int lane, Diag diag) const { return diagnostics[lane * DIAG_COUNT + static_cast<unsigned int>(diag)]; }
+
+        // Lane groups executed, to see how much the lanes diverge:
+        // Groups() == Steps() means they never did, Groups() == Steps() *
+        // Lanes() that every lane ran on its own
+        uint64_t Steps() const { return steps; }
+        uint64_t Groups() const { return groups; }
+
+    private:
+        unsigned int lanes;
+        unsigned int stride;              // lanes rounded up to a whole vector
+
+        // Structure of arrays, stride entries each
+        std::vector<uint8_t> V;           // V[r * stride + lane]
+        std::vector<uint16_t> pc;
+        std::vector<uint16_t> index;
+        std::vector<uint8_t> sp;
+        std::vector<uint8_t> delayTimer;
+        std::vector<uint8_t> soundTimer;
+        std::vector<uint16_t> keys;
+
+        // Per lane
+        std::vector<uint8_t> memory;      // LANE_MEMORY per lane
+        std::vector<uint16_t> stack;      // STACK_LEVELS per lane
+        std::vector<uint64_t> video;      // VIDEO_HEIGHT per lane
+        std::vector<uint64_t> randState;
+        std::vector<uint8_t> invalidCount;
+        std::vector<uint32_t> dirtyRows;
+        std::vector<uint8_t> drawFlag;
+        std::vector<uint64_t> diagnostics;
+
+        // Program as loaded, pre-decoded, and which pages each lane has
+        // since stored into (bit n = bytes [64n, 64n + 64))
+        std::vector<uint8_t> code;
+        std::vector<Instruction> codeDecoded;
+        std::vector<uint64_t> dirtyPages;
+        uint64_t anyDirty{};              // union over all lanes
+
+        std::vector<uint8_t> allLanes8;   // masks selecting every real lane
+        std::vector<uint16_t> allLanes16;
+
+        // Scratch for one step
+        std::vector<Instruction> fetched;
+        std::vector<uint16_t> opcodes;
+        std::vector<uint16_t> pending16;  // 0xFFFF while the lane has not executed
+        std::vector<uint8_t> mask8;       // 0xFF for lanes in the current group
+        std::vector<uint16_t> mask16;
+
+        uint64_t steps{};
+        uint64_t groups{};
+        bool avx2{};
+
+        void SetCode(uint8_t const* image);
+        void MarkDirty(unsigned int lane, unsigned int address, unsigned int length);
+        bool FetchShared(Instruction& in);
+        bool SamePc(uint16_t value) const;
+        bool SamePcAVX2(uint16_t value) const;
+        bool Step();
+        void RunLanes(uint64_t cycles);
+        Instruction FetchLane(unsigned int lane);
+        unsigned int Group(uint16_t opcode);
+        unsigned int GroupAVX2(uint16_t opcode);
+        bool ExecuteAVX2(Instruction const& in, uint8_t const* mask8, uint16_t const* mask16);
+        void ExecuteLane(unsigned int lane, Instruction const& in);
+        void Report(unsigned int lane, Diag diag, uint16_t a = 0, uint16_t b = 0);
+        void ResetLane(unsigned int lane);
+};
@@ -0,0 +1,402 @@
+#include "chip.hpp"
+#include "env.hpp"
+#include "jit.hpp"
+#include "video.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Benchmarks for the core. Micro benchmarks time one kind of work in
+// isolation; macro benchmarks run small synthetic programs for a fixed
+// instruction count. Results are printed as JSON so runs can be diffed.
+
+const unsigned int REPETITIONS = 5;                 // best of, to shed scheduler noise
+const uint64_t MICRO_OPS = 2000000;
+const uint64_t DEFAULT_MACRO_INSTRUCTIONS = 10000000;
+
+struct Result {
+    std::string group;
+    std::string name;
+    std::string variant;
+    uint64_t ops;
+    double seconds;     // best repetition
+};
+
+// Assembles a ROM one opcode at a time
+struct RomBuilder {
+    std::vector<uint8_t> bytes;
+
+    uint16_t Here() const { return static_cast<uint16_t>(START_ADDRESS + bytes.size()); }
+
+    RomBuilder& Op(uint16_t opcode) {
+        bytes.push_back(static_cast<uint8_t>(opcode >> 8));
+        bytes.push_back(static_cast<uint8_t>(opcode));
+        return *this;
+    }
+
+    // Appends body count times followed by a jump back to the first copy
+    RomBuilder& Loop(std::vector<uint16_t> const& body, unsigned int count) {
+        uint16_t start = Here();
+        for (unsigned int i = 0; i < count; ++i) {
+            for (uint16_t opcode : body) {
+                Op(opcode);
+            }
+        }
+        return Op(0x1000 | start);
+    }
+};
+
+// Collected results plus the --filter selection
+struct Suite {
+    std::vector<Result> results;
+    std::string filter;
+
+    bool Wants(std::string const& group, std::string const& name) const {
+        return filter.empty() || filter == group || name.find(filter) != std::string::npos;
+    }
+};
+
+struct Variant {
+    char const* name;
+    bool jit;
+    Core core;
+};
+
+static std::vector<Variant> Variants() {
+    std::vector<Variant> variants{
+        {"table", false, Core::Table},
+        {"switch", false, Core::Switch},
+        {"cached", false, Core::Cached},
+    };
+    if (Jit::Supported()) {
+        variants.push_back({"jit", true, Core::Switch});
+    }
+    return variants;
+}
+
+static double BestOf(std::function<void()> const& body) {
+    body();   // warm up caches, decode cache and JIT blocks
+
+    double best = 1e300;
+    for (unsigned int i = 0; i < REPETITIONS; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+    return best;
+}
+
+// Runs ops instructions of rom on every core
+static void RunRom(Suite& suite, std::string const& group, std::string const& name,
+                   std::vector<uint8_t> const& rom, uint64_t ops) {
+    if (!suite.Wants(group, name)) {
+        return;
+    }
+
+    for (Variant const& variant : Variants()) {
+        // Most of these loops repeat one state, which Run() would skip
+        Chip8 chip;
+        chip.Seed(1);
+        chip.SetCore(variant.core);
+        chip.SetIdleSkip(false);
+        chip.LoadROM(rom.data(), rom.size());
+        Jit jit;
+
+        double seconds = BestOf([&] {
+            if (variant.jit) {
+                jit.Run(chip, ops);
+            } else {
+                chip.Run(ops);
+            }
+        });
+        suite.results.push_back({group, name, variant.name, ops, seconds});
+    }
+}
+
+// Single Cycle() calls, i.e. dispatch plus per-instruction overhead
+static void BenchCycle(Suite& suite) {
+    if (!suite.Wants("micro", "cycle_dispatch")) {
+        return;
+    }
+
+    RomBuilder rom;
+    rom.Loop({0x7001, 0x8104, 0x6207, 0xA300, 0x3000, 0x8213}, 16);
+
+    for (Variant const& variant : Variants()) {
+        if (variant.jit) {
+            continue;
+        }
+
+        Chip8 chip;
+        chip.SetCore(variant.core);
+        chip.LoadROM(rom.bytes.data(), rom.bytes.size());
+
+        double seconds = BestOf([&] {
+            for (uint64_t i = 0; i < MICRO_OPS; ++i) {
+                chip.Cycle();
+            }
+        });
+        suite.results.push_back({"micro", "cycle_dispatch", variant.name, MICRO_OPS, seconds});
+    }
+}
+
+static void BenchFamilies(Suite& suite) {
+    struct Family {
+        char const* name;
+        std::vector<uint16_t> setup;
+        std::vector<uint16_t> body;
+    };
+
+    // Skips are arranged not to fire (V0 = 0, V1 = 1) except ExA1, which
+    // hops over a filler, and calls return straight away
+    std::vector<Family> families{
+        {"load_6xkk", {}, {0x6012, 0x6134, 0x6256, 0x6378}},
+        {"add_7xkk", {}, {0x7001, 0x7102, 0x7203, 0x7304}},
+        {"alu_8xyn", {}, {0x8010, 0x8121, 0x8232, 0x8343, 0x8454, 0x8565, 0x8676, 0x8787, 0x889E}},
+        {"skip_3_4_5_9", {0x6000, 0x6101}, {0x3001, 0x4000, 0x5010, 0x9000}},
+        {"index_annn_fx1e", {0x6002}, {0xA300, 0xF01E, 0xA400, 0xF01E}},
+        {"bcd_fx33", {0x60FF, 0xA800}, {0xF033}},
+        {"store_fx55", {0xA800}, {0xF755}},
+        {"load_fx65", {0xA800}, {0xF765}},
+        {"timers_fx07_fx15_fx18", {}, {0xF007, 0xF015, 0xF018}},
+        {"random_cxkk", {}, {0xC0FF, 0xC10F}},
+        {"keys_ex9e_exa1", {0x6000}, {0xE09E, 0xE0A1, 0x6000}},
+        {"font_fx29", {0x6007}, {0xF029}},
+        {"clear_00e0", {}, {0x00E0}},
+    };
+
+    for (Family const& family : families) {
+        RomBuilder rom;
+        for (uint16_t opcode : family.setup) {
+            rom.Op(opcode);
+        }
+        rom.Loop(family.body, 16);
+        RunRom(suite, "micro", family.name, rom.bytes, MICRO_OPS);
+    }
+
+    // 2nnn/00EE pair: call a subroutine that returns immediately
+    RomBuilder call;
+    call.Op(0x2206).Op(0x2206).Op(0x1200).Op(0x00EE);
+    RunRom(suite, "micro", "call_2nnn_00ee", call.bytes, MICRO_OPS);
+}
+
+static void BenchDraw(Suite& suite) {
+    struct Case {
+        char const* name;
+        uint8_t x;
+        uint8_t y;
+    };
+
+    std::vector<Case> cases{
+        {"aligned", 8, 4},
+        {"unaligned", 13, 4},
+        {"clip_right", 60, 4},
+        {"clip_bottom", 13, 29},
+    };
+
+    for (unsigned int height : {1u, 5u, 8u, 15u}) {
+        for (Case const& c : cases) {
+            // Drawing twice restores the screen, keeping every pass identical
+            RomBuilder rom;
+            rom.Op(0x6000 | c.x).Op(0x6100 | c.y).Op(0xA050);
+            rom.Loop({static_cast<uint16_t>(0xD010 | height)}, 16);
+
+            std::string name = "draw_dxyn_h" + std::to_string(height) + "_" + c.name;
+            RunRom(suite, "micro", name, rom.bytes, MICRO_OPS);
+        }
+    }
+}
+
+// Framebuffer to ARGB, as the frontend does before uploading
+static void BenchExpand(Suite& suite) {
+    static uint64_t rows[VIDEO_HEIGHT];
+    static uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
+
+    uint64_t pattern = 0x9E3779B97F4A7C15ull;
+    for (uint64_t& row : rows) {
+        pattern = pattern * 6364136223846793005ull + 1442695040888963407ull;
+        row = pattern;
+    }
+
+    std::string kernel = ExpandRowsKernel();
+    std::vector<std::pair<char const*, ExpandRowsFunc>> kernels{{"scalar", ExpandRowsScalar}};
+    if (kernel != "scalar") {
+        kernels.push_back({"sse2", ExpandRowsSSE2});
+    }
+    if (kernel == "avx2") {
+        kernels.push_back({"avx2", ExpandRowsAVX2});
+    }
+
+    const uint64_t frames = 20000;
+    for (auto const& k : kernels) {
+        for (unsigned int rowCount : {1u, VIDEO_HEIGHT}) {
+            std::string name = rowCount == 1 ? "expand_argb_row" : "expand_argb_frame";
+            if (!suite.Wants("micro", name)) {
+                continue;
+            }
+
+            double seconds = BestOf([&] {
+                for (uint64_t i = 0; i < frames; ++i) {
+                    k.second(rows, pixels, 0, rowCount, 0xFFFFFFFF, 0xFF000000);
+                    rows[0] ^= pixels[i & 63];   // keep the calls from being hoisted
+                }
+            });
+
+            suite.results.push_back({"micro", name, k.first, frames, seconds});
+        }
+    }
+}
+
+static void BenchPrograms(Suite& suite, uint64_t instructions) {
+    // Counter loop with a carry-style skip
+    RomBuilder alu;
+    alu.Op(0x6000)
+       .Op(0x7001).Op(0x8104).Op(0x8213).Op(0x8326).Op(0x8435)
+       .Op(0x4000).Op(0x7501)
+       .Op(0x1202);
+
+    // Moving sprites with a periodic clear
+    RomBuilder draw;
+    draw.Op(0x00E0)
+        .Op(0xA050).Op(0xD015).Op(0x7003).Op(0x7102)
+        .Op(0xF229).Op(0xD235).Op(0x7201).Op(0x7307)
+        .Op(0x3300).Op(0x1202)
+        .Op(0x00E0).Op(0x1202);
+
+    // Three-deep call chain
+    RomBuilder calls;
+    calls.Op(0x2204).Op(0x1200)
+         .Op(0x7001).Op(0x220C).Op(0x00EE).Op(0x0000)
+         .Op(0x8104).Op(0x2214).Op(0x00EE).Op(0x0000)
+         .Op(0x7201).Op(0x00EE);
+
+    // Score keeping: random, BCD, reload and draw digits
+    RomBuilder score;
+    score.Op(0xC0FF).Op(0xA800).Op(0xF033).Op(0xF265)
+         .Op(0xF029).Op(0x6300).Op(0x6400).Op(0xD345)
+         .Op(0xF129).Op(0x7305).Op(0xD345)
+         .Op(0xF007).Op(0x1200);
+
+    RunRom(suite, "macro", "alu_loop", alu.bytes, instructions);
+    RunRom(suite, "macro", "draw_loop", draw.bytes, instructions);
+    RunRom(suite, "macro", "call_return", calls.bytes, instructions);
+    RunRom(suite, "macro", "score_bcd", score.bytes, instructions);
+}
+
+// Environment steps per second: four frames each, with a BCD score as reward
+static void BenchEnv(Suite& suite) {
+    if (!suite.Wants("env", "env_step")) {
+        return;
+    }
+
+    RomBuilder rom;
+    rom.Op(0xC0FF).Op(0xA800).Op(0xF033).Op(0xF265)
+       .Op(0xF029).Op(0x6300).Op(0x6400).Op(0xD345)
+       .Op(0xF129).Op(0x7305).Op(0xD345)
+       .Op(0xF007).Op(0x1200);
+
+    const unsigned int envs = 256;
+    const unsigned int steps = 400;
+
+    struct Case {
+        char const* variant;
+        ObsFormat format;
+        unsigned int threads;
+    };
+
+    for (Case const& c : {Case{"packed", ObsFormat::Packed, 1}, Case{"bytes", ObsFormat::Bytes, 1},
+                          Case{"packed_threads", ObsFormat::Packed, 0}}) {
+        EnvOptions options;
+        options.format = c.format;
+        options.threads = c.threads;
+        options.reward = {ScoreFormat::Digits, 0x800, 3};
+
+        Chip8Env env(envs, options);
+        env.LoadROM(rom.bytes.data(), rom.bytes.size());
+
+        std::vector<uint8_t> observations(envs * env.ObservationSize());
+        std::vector<uint16_t> actions(envs);
+        std::vector<float> rewards(envs);
+        std::vector<uint8_t> dones(envs);
+        env.Reset(1, observations.data());
+
+        double seconds = BestOf([&] {
+            for (unsigned int i = 0; i < steps; ++i) {
+                actions[i % envs] ^= 1u << (i & 15u);
+                env.Step(actions.data(), observations.data(), rewards.data(), dones.data());
+            }
+        });
+        suite.results.push_back({"env", "env_step", c.variant, uint64_t(envs) * steps, seconds});
+    }
+}
+
+static std::string Json(std::vector<Result> const& results, uint64_t instructions) {
+    std::ostringstream out;
+    out << "{\n"
+        << "  \"expand_kernel\": \"" << ExpandRowsKernel() << "\",\n"
+        << "  \"jit_supported\": " << (Jit::Supported() ? "true" : "false") << ",\n"
+        << "  \"repetitions\": " << REPETITIONS << ",\n"
+        << "  \"macro_instructions\": " << instructions << ",\n"
+        << "  \"results\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        Result const& r = results[i];
+        double nsPerOp = r.seconds * 1e9 / r.ops;
+        double mips = r.seconds > 0.0 ? r.ops / r.seconds / 1e6 : 0.0;
+
+        out << "    {\"group\": \"" << r.group << "\", \"name\": \"" << r.name
+            << "\", \"variant\": \"" << r.variant << "\", \"ops\": " << r.ops
+            << ", \"seconds\": " << r.seconds << ", \"ns_per_op\": " << nsPerOp;
+        if (r.group == "macro") {
+            out << ", \"mips\": " << mips;
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    if (argc % 2 == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--filter micro|macro|env|<name substring>] [--instructions N]\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::string filter;
+    uint64_t instructions = DEFAULT_MACRO_INSTRUCTIONS;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+
+        if (option == "--filter") {
+            filter = value;
+        } else if (option == "--instructions") {
+            instructions = std::max<uint64_t>(1, std::stoull(value));
+        } else {
+            std::cerr << "Unknown option: " << option << " " << value << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    Suite suite;
+    suite.filter = filter;
+
+    BenchCycle(suite);
+    BenchFamilies(suite);
+    BenchDraw(suite);
+    BenchExpand(suite);
+    BenchPrograms(suite, instructions);
+    BenchEnv(suite);
+
+    std::cout << Json(suite.results, instructions);
+    return 0;
+}
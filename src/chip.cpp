@@ -1,14 +1,14 @@
 #include "chip.hpp"
+#include "log.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
 #include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <chrono>
-#include <random>
 #include <iostream>
 #include <algorithm>
-
-const unsigned int FONTSET_SIZE = 80;
-const unsigned int FONTSET_START_ADDRESS = 0x50;
+#include <atomic>
 
 uint8_t fontset[FONTSET_SIZE] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -30,12 +30,12 @@ uint8_t fontset[FONTSET_SIZE] = {
 };
 
 
-void Chip8::LoadROM(char const* filename) {
+bool Chip8::LoadROM(char const* filename) {
     std::ifstream file(filename, std::ios::binary | std::ios::ate);
     
     if (!file.is_open()) {
         std::cerr << "ERROR: Failed to open ROM file\n";
-        return;
+        return false;
     }
 
     std::streampos size = file.tellg();
@@ -43,33 +43,232 @@ void Chip8::LoadROM(char const* filename) {
     if (size <= 0) {
         std::cerr << "ERROR: ROM file is empty or invalid\n";
         file.close();
-        return;
+        return false;
+    }
+
+    std::vector<uint8_t> rom(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(rom.data()), size);
+    file.close();
+
+    return LoadROM(rom.data(), rom.size());
+}
+
+// Epochs are unique across machines, so translated code cached for one
+// machine is never reused by another that happens to reuse its address
+static uint32_t NextCodeEpoch() {
+    static std::atomic<uint32_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Chip8::LoadROM(uint8_t const* data, size_t size) {
+    if (size == 0) {
+        std::cerr << "ERROR: ROM is empty\n";
+        return false;
     }
 
-    if (size > (4096 - START_ADDRESS)) {
+    if (size > (MEMORY_SIZE - START_ADDRESS)) {
         std::cerr << "WARNING: ROM size (" << size << " bytes) exceeds available memory (" 
-                  << (4096 - START_ADDRESS) << " bytes)\n";
+                  << (MEMORY_SIZE - START_ADDRESS) << " bytes)\n";
     }
 
-    char* buffer = new char[size];
-    file.seekg(0, std::ios::beg);
-    file.read(buffer, size);
-    file.close();
+    size_t count = std::min<size_t>(size, MEMORY_SIZE - START_ADDRESS);
+    memcpy(&memory[START_ADDRESS], data, count);
 
-    for (long i = 0; i < std::min<uint16_t>(size, 16L); ++i) {
-        memory[START_ADDRESS + i] = buffer[i];
+    codeEpoch = NextCodeEpoch();
+
+    return true;
+}
+
+void Chip8::SaveState(Chip8State& state) const {
+    state.magic = STATE_MAGIC;
+    state.version = STATE_VERSION;
+    state.keys = 0;
+    for (unsigned int key = 0; key < KEY_COUNT; ++key) {
+        state.keys |= (keypad[key] ? 1u : 0u) << key;
     }
+    state.randState = hot.randState;
+    memcpy(state.video, video, sizeof(video));
+    state.index = hot.index;
+    state.pc = hot.pc;
+    memcpy(state.stack, hot.stack, sizeof(hot.stack));
+    state.sp = hot.sp;
+    state.delayTimer = hot.delayTimer;
+    state.soundTimer = hot.soundTimer;
+    state.invalidCount = hot.invalidCount;
+    memcpy(state.registers, hot.registers, sizeof(hot.registers));
+    memcpy(state.memory, memory, sizeof(memory));
+}
 
-    delete[] buffer;
+bool Chip8::LoadState(Chip8State const& state) {
+    if (state.magic != STATE_MAGIC || state.version != STATE_VERSION) {
+        std::cerr << "ERROR: Unsupported save state (version " << state.version << ")\n";
+        return false;
+    }
+
+    SetKeys(state.keys);
+    hot.randState = state.randState != 0 ? state.randState : 1;
+    memcpy(video, state.video, sizeof(video));
+    hot.index = state.index;
+    hot.pc = state.pc;
+    memcpy(hot.stack, state.stack, sizeof(hot.stack));
+    hot.sp = state.sp <= STACK_LEVELS ? state.sp : 0;
+    hot.delayTimer = state.delayTimer;
+    hot.soundTimer = state.soundTimer;
+    hot.invalidCount = state.invalidCount;
+    memcpy(hot.registers, state.registers, sizeof(hot.registers));
+    memcpy(memory, state.memory, sizeof(memory));
+
+    codeEpoch = NextCodeEpoch();
+    dirtyRows = ~0u;
+    drawFlag = true;
+
+    return true;
 }
 
-void Chip8::Cycle() {
-    pc = std::clamp(pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
-    opcode = (memory[pc] << 8u) | memory[pc + 1];
-    pc += 2;
+void Chip8::Seed(uint64_t seed) {
+    hot.randState = SeedState(seed);
+}
+
+// splitmix64 finaliser, so nearby seeds give unrelated streams
+uint64_t Chip8::SeedState(uint64_t seed) {
+    seed += 0x9E3779B97F4A7C15ull;
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ull;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBull;
+    seed ^= seed >> 31;
+    return seed != 0 ? seed : 1;
+}
+
+// FNV-1a over the snapshot, for comparing runs
+uint64_t Chip8::StateHash() const {
+    Chip8State state;
+    SaveState(state);
+    return HashState(state);
+}
+
+uint64_t Chip8::HashState(Chip8State const& state) {
+    uint8_t const* bytes = reinterpret_cast<uint8_t const*>(&state);
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(state); ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// xorshift64*, one word of state so it snapshots trivially
+uint8_t Chip8::RandomByte() {
+    hot.randState ^= hot.randState >> 12;
+    hot.randState ^= hot.randState << 25;
+    hot.randState ^= hot.randState >> 27;
+    return static_cast<uint8_t>((hot.randState * 2685821657736338717ull) >> 56);
+}
+
+char const* OpName(Op op) {
+    static char const* const names[OP_COUNT] = {
+        "00E0", "00EE", "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk", "7xkk",
+        "8xy0", "8xy1", "8xy2", "8xy3", "8xy4", "8xy5", "8xy6", "8xy7", "8xyE",
+        "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", "Ex9E", "ExA1",
+        "Fx07", "Fx0A", "Fx15", "Fx18", "Fx1E", "Fx29", "Fx33", "Fx55", "Fx65",
+        "Null", "Invalid",
+    };
+    return names[static_cast<unsigned int>(op)];
+}
+
+static Instruction Operands(uint16_t opcode) {
+    Instruction in{};
+    in.opcode = opcode;
+    in.nnn = opcode & 0x0FFFu;
+    in.x = (opcode & 0x0F00u) >> 8u;
+    in.y = (opcode & 0x00F0u) >> 4u;
+    in.kk = opcode & 0x00FFu;
+    return in;
+}
+
+// Mirrors the table layout: unassigned slots map to OP_NULL, Fx ops above
+// 0x65 are rejected by HandleInvalidOpcode.
+Instruction Chip8::Decode(uint16_t opcode) {
+    Instruction in = Operands(opcode);
+
+    switch (opcode >> 12u) {
+        case 0x0:
+            switch (opcode & 0x000Fu) {
+                case 0x0: in.op = Op::Op00E0; break;
+                case 0xE: in.op = Op::Op00EE; break;
+                default: in.op = Op::Null; break;
+            }
+            break;
+        case 0x1: in.op = Op::Op1nnn; break;
+        case 0x2: in.op = Op::Op2nnn; break;
+        case 0x3: in.op = Op::Op3xkk; break;
+        case 0x4: in.op = Op::Op4xkk; break;
+        case 0x5: in.op = Op::Op5xy0; break;
+        case 0x6: in.op = Op::Op6xkk; break;
+        case 0x7: in.op = Op::Op7xkk; break;
+        case 0x8:
+            switch (opcode & 0x000Fu) {
+                case 0x0: in.op = Op::Op8xy0; break;
+                case 0x1: in.op = Op::Op8xy1; break;
+                case 0x2: in.op = Op::Op8xy2; break;
+                case 0x3: in.op = Op::Op8xy3; break;
+                case 0x4: in.op = Op::Op8xy4; break;
+                case 0x5: in.op = Op::Op8xy5; break;
+                case 0x6: in.op = Op::Op8xy6; break;
+                case 0x7: in.op = Op::Op8xy7; break;
+                case 0xE: in.op = Op::Op8xyE; break;
+                default: in.op = Op::Null; break;
+            }
+            break;
+        case 0x9: in.op = Op::Op9xy0; break;
+        case 0xA: in.op = Op::OpAnnn; break;
+        case 0xB: in.op = Op::OpBnnn; break;
+        case 0xC: in.op = Op::OpCxkk; break;
+        case 0xD: in.op = Op::OpDxyn; break;
+        case 0xE:
+            switch (opcode & 0x000Fu) {
+                case 0x1: in.op = Op::OpExA1; break;
+                case 0xE: in.op = Op::OpEx9E; break;
+                default: in.op = Op::Null; break;
+            }
+            break;
+        case 0xF:
+            switch (opcode & 0x00FFu) {
+                case 0x07: in.op = Op::OpFx07; break;
+                case 0x0A: in.op = Op::OpFx0A; break;
+                case 0x15: in.op = Op::OpFx15; break;
+                case 0x18: in.op = Op::OpFx18; break;
+                case 0x1E: in.op = Op::OpFx1E; break;
+                case 0x29: in.op = Op::OpFx29; break;
+                case 0x33: in.op = Op::OpFx33; break;
+                case 0x55: in.op = Op::OpFx55; break;
+                case 0x65: in.op = Op::OpFx65; break;
+                default: in.op = (opcode & 0x00FFu) > 0x65 ? Op::Invalid : Op::Null; break;
+            }
+            break;
+    }
+
+    return in;
+}
+
+// Number of bytes the opcode stores at I (OP_Fx33, OP_Fx55), 0 otherwise
+uint16_t Chip8::StoreLength(uint16_t opcode) {
+    if ((opcode & 0xF0FFu) == 0xF055u) {
+        return ((opcode & 0x0F00u) >> 8u) + 1;
+    }
+    if ((opcode & 0xF0FFu) == 0xF033u) {
+        return 3;
+    }
+    return 0;
+}
+
+void Chip8::CycleTable() {
+    hot.pc = std::clamp(hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+    uint16_t opcode = (memory[hot.pc] << 8u) | memory[hot.pc + 1];
+    instr = Operands(opcode);
+    hot.pc += 2;
     
     uint8_t op_high = (opcode & 0xF000) >> 12;
-    if (op_high > 0xF || !table[op_high]) {
+    if (op_high > 0xF || !dispatch.table[op_high]) {
         HandleInvalidOpcode();
         return;
     }
@@ -79,510 +278,802 @@ void Chip8::Cycle() {
         return;
     }
 
-    if (sp >= 16) {
-        std::cerr << "STACK OVERFLOW! Resetting...\n";
-        Reset();
+    if ((opcode & 0xFF00) == 0xF600 && (opcode & 0x00FF) > 0x65) {
+        Report(Diag::ProblematicOpcode, opcode);
+        HandleInvalidOpcode();
         return;
     }
 
-    if ((opcode & 0xFF00) == 0xF600 && (opcode & 0x00FF) > 0x65) {
-        std::cerr << "Detected problematic opcode pattern: " << std::hex << opcode << "\n";
-        HandleInvalidOpcode();
+    (this->*dispatch.table[op_high])();
+}
+
+// Same decode as the tables above, but every handler is a direct call the
+// compiler can inline, and impossible cases are not re-checked per cycle.
+void Chip8::CycleSwitch() {
+    hot.pc = std::clamp(hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+    uint16_t opcode = (memory[hot.pc] << 8u) | memory[hot.pc + 1];
+    instr = Operands(opcode);
+    hot.pc += 2;
+
+    switch (opcode >> 12u) {
+        case 0x0:
+            switch (opcode & 0x000Fu) {
+                case 0x0: OP_00E0(); break;
+                case 0xE: OP_00EE(); break;
+                default: OP_NULL(); break;
+            }
+            break;
+        case 0x1: OP_1nnn(); break;
+        case 0x2: OP_2nnn(); break;
+        case 0x3: OP_3xkk(); break;
+        case 0x4: OP_4xkk(); break;
+        case 0x5: OP_5xy0(); break;
+        case 0x6: OP_6xkk(); break;
+        case 0x7: OP_7xkk(); break;
+        case 0x8:
+            switch (opcode & 0x000Fu) {
+                case 0x0: OP_8xy0(); break;
+                case 0x1: OP_8xy1(); break;
+                case 0x2: OP_8xy2(); break;
+                case 0x3: OP_8xy3(); break;
+                case 0x4: OP_8xy4(); break;
+                case 0x5: OP_8xy5(); break;
+                case 0x6: OP_8xy6(); break;
+                case 0x7: OP_8xy7(); break;
+                case 0xE: OP_8xyE(); break;
+                default: OP_NULL(); break;
+            }
+            break;
+        case 0x9: OP_9xy0(); break;
+        case 0xA: OP_Annn(); break;
+        case 0xB: OP_Bnnn(); break;
+        case 0xC: OP_Cxkk(); break;
+        case 0xD: OP_Dxyn(); break;
+        case 0xE:
+            switch (opcode & 0x000Fu) {
+                case 0x1: OP_ExA1(); break;
+                case 0xE: OP_Ex9E(); break;
+                default: OP_NULL(); break;
+            }
+            break;
+        case 0xF:
+            switch (opcode & 0x00FFu) {
+                case 0x07: OP_Fx07(); break;
+                case 0x0A: OP_Fx0A(); break;
+                case 0x15: OP_Fx15(); break;
+                case 0x18: OP_Fx18(); break;
+                case 0x1E: OP_Fx1E(); break;
+                case 0x29: OP_Fx29(); break;
+                case 0x33: OP_Fx33(); break;
+                case 0x55: OP_Fx55(); break;
+                case 0x65: OP_Fx65(); break;
+                default:
+                    if ((opcode & 0x00FFu) > 0x65) {
+                        HandleInvalidOpcode();
+                        return;
+                    }
+                    OP_NULL();
+                    break;
+            }
+            break;
+    }
+}
+
+// Looks the opcode up in a table decoded once per process instead of
+// decoding it every cycle. Keyed by opcode rather than address, so stores
+// into the program need no invalidation.
+void Chip8::CycleCached(Instruction const* decoded) {
+    hot.pc = std::clamp(hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+    instr = decoded[(memory[hot.pc] << 8u) | memory[hot.pc + 1]];
+    hot.pc += 2;
+
+    switch (instr.op) {
+        case Op::Op00E0: OP_00E0(); break;
+        case Op::Op00EE: OP_00EE(); break;
+        case Op::Op1nnn: OP_1nnn(); break;
+        case Op::Op2nnn: OP_2nnn(); break;
+        case Op::Op3xkk: OP_3xkk(); break;
+        case Op::Op4xkk: OP_4xkk(); break;
+        case Op::Op5xy0: OP_5xy0(); break;
+        case Op::Op6xkk: OP_6xkk(); break;
+        case Op::Op7xkk: OP_7xkk(); break;
+        case Op::Op8xy0: OP_8xy0(); break;
+        case Op::Op8xy1: OP_8xy1(); break;
+        case Op::Op8xy2: OP_8xy2(); break;
+        case Op::Op8xy3: OP_8xy3(); break;
+        case Op::Op8xy4: OP_8xy4(); break;
+        case Op::Op8xy5: OP_8xy5(); break;
+        case Op::Op8xy6: OP_8xy6(); break;
+        case Op::Op8xy7: OP_8xy7(); break;
+        case Op::Op8xyE: OP_8xyE(); break;
+        case Op::Op9xy0: OP_9xy0(); break;
+        case Op::OpAnnn: OP_Annn(); break;
+        case Op::OpBnnn: OP_Bnnn(); break;
+        case Op::OpCxkk: OP_Cxkk(); break;
+        case Op::OpDxyn: OP_Dxyn(); break;
+        case Op::OpEx9E: OP_Ex9E(); break;
+        case Op::OpExA1: OP_ExA1(); break;
+        case Op::OpFx07: OP_Fx07(); break;
+        case Op::OpFx0A: OP_Fx0A(); break;
+        case Op::OpFx15: OP_Fx15(); break;
+        case Op::OpFx18: OP_Fx18(); break;
+        case Op::OpFx1E: OP_Fx1E(); break;
+        case Op::OpFx29: OP_Fx29(); break;
+        case Op::OpFx33: OP_Fx33(); break;
+        case Op::OpFx55: OP_Fx55(); break;
+        case Op::OpFx65: OP_Fx65(); break;
+        case Op::Invalid:
+            HandleInvalidOpcode();
+            return;
+        default: OP_NULL(); break;
+    }
+}
+
+void Chip8::Cycle() {
+    if constexpr (PROFILER_COMPILED) {
+        if (profiler || tracer) {
+            RunInstrumented(1);
+            return;
+        }
+    }
+
+    switch (core) {
+        case Core::Table: CycleTable(); break;
+        case Core::Switch: CycleSwitch(); break;
+        case Core::Cached: CycleCached(DecodeTable()); break;
+    }
+}
+
+void Chip8::Run(uint64_t cycles) {
+    // Checked once per call, so the loops below stay free of profiling
+    if constexpr (PROFILER_COMPILED) {
+        if (profiler || tracer) {
+            RunInstrumented(cycles);
+            return;
+        }
+    }
+
+    switch (core) {
+        case Core::Table:
+            RunLoop(cycles, [this] { CycleTable(); });
+            break;
+        case Core::Switch:
+            RunLoop(cycles, [this] { CycleSwitch(); });
+            break;
+        case Core::Cached: {
+            Instruction const* decoded = DecodeTable();
+            RunLoop(cycles, [this, decoded] { CycleCached(decoded); });
+            break;
+        }
+    }
+}
+
+// Executes cycles instructions, fast-forwarding idle loops. Timers and keys
+// only change between calls, so once a loop comes back to the exact hot
+// state it left, without storing, drawing or reporting on the way, it
+// will repeat that same iteration until the call ends. Whole iterations
+// are then skipped and only the remainder is executed, which ends in the
+// same state as running every instruction.
+template <typename Step>
+void Chip8::RunLoop(uint64_t cycles, Step step) {
+    if (!idleSkip) {
+        for (uint64_t i = 0; i < cycles; ++i) {
+            step();
+        }
         return;
     }
 
-    (this->*table[op_high])();
-    delayTimer = std::max(0, delayTimer - 1);
-    soundTimer = std::max(0, soundTimer - 1);
+    HotState anchor;
+    bool anchored = false;
+    uint64_t anchorCycle = 0;
+    uint32_t anchorEffects = 0;
+    idleJump = false;
+
+    for (uint64_t i = 0; i < cycles; ++i) {
+        step();
+        if (!idleJump) {
+            continue;
+        }
+
+        // Checked only when the loop jumps back, i.e. once per iteration
+        idleJump = false;
+        if (anchored && effects == anchorEffects && memcmp(&anchor, &hot, sizeof(hot)) == 0) {
+            uint64_t period = i - anchorCycle;
+            uint64_t skipped = (cycles - i - 1) / period * period;
+            idleCycles += skipped;
+            i += skipped;
+            anchorCycle = i;
+        } else {
+            anchor = hot;
+            anchored = true;
+            anchorCycle = i;
+            anchorEffects = effects;
+        }
+    }
+}
+
+// Same as Run, reporting every instruction to the profiler and tracer
+void Chip8::RunInstrumented(uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; ++i) {
+        uint16_t address = std::clamp(hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+        uint16_t opcode = (memory[address] << 8u) | memory[address + 1];
+
+        bool timed = profiler && profiler->Record(address, Decode(opcode).op, memory, hot.stack, hot.sp);
+        auto start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+
+        TraceRegs before;
+        if (tracer) {
+            memcpy(before.V, hot.registers, sizeof(hot.registers));
+            before.index = hot.index;
+            before.sp = hot.sp;
+            before.delayTimer = hot.delayTimer;
+            before.soundTimer = hot.soundTimer;
+        }
+
+        switch (core) {
+            case Core::Table: CycleTable(); break;
+            case Core::Switch: CycleSwitch(); break;
+            case Core::Cached: CycleCached(DecodeTable()); break;
+        }
+
+        if (timed) {
+            profiler->AddTime(opcode, std::chrono::steady_clock::now() - start);
+        }
+
+        if (tracer) {
+            TraceRegs after;
+            memcpy(after.V, hot.registers, sizeof(hot.registers));
+            after.index = hot.index;
+            after.sp = hot.sp;
+            after.delayTimer = hot.delayTimer;
+            after.soundTimer = hot.soundTimer;
+
+            // Same bounds the store handlers check before writing
+            uint16_t stored = StoreLength(opcode);
+            bool wrote = stored > 0 && before.index + stored <= MEMORY_SIZE;
+            tracer->Record(address, opcode, before, after, before.index,
+                           wrote ? &memory[before.index] : nullptr, static_cast<uint8_t>(stored));
+        }
+    }
+}
+
+// Called once per 60 Hz frame by whoever drives the emulator
+void Chip8::TickTimers() {
+    if (hot.delayTimer > 0) {
+        --hot.delayTimer;
+    }
+    buzzing = hot.soundTimer > 0;
+    if (hot.soundTimer > 0) {
+        --hot.soundTimer;
+    }
+}
+
+void Chip8::SetKeys(uint16_t mask) {
+    for (unsigned int key = 0; key < KEY_COUNT; ++key) {
+        keypad[key] = (mask >> key) & 1u;
+    }
+}
+
+void Chip8::SetCore(Core newCore) {
+    core = newCore;
+}
+
+Instruction const* Chip8::DecodeTable() {
+    static std::vector<Instruction> const decoded = [] {
+        std::vector<Instruction> table(0x10000);
+        for (uint32_t opcode = 0; opcode < table.size(); ++opcode) {
+            table[opcode] = Decode(static_cast<uint16_t>(opcode));
+        }
+        return table;
+    }();
+    return decoded.data();
+}
+
+void Chip8::ExpandVideo(uint8_t* pixels) const {
+    for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y) {
+        for (unsigned int x = 0; x < VIDEO_WIDTH; ++x) {
+            pixels[y * VIDEO_WIDTH + x] = (video[y] >> (63u - x)) & 1u;
+        }
+    }
 }
 
 void Chip8::HandleInvalidOpcode() {
-    std::cerr << "INVALID OPCODE: " << std::hex << opcode 
-              << " at PC=" << (pc-2) << "\n";
-    pc = START_ADDRESS;
+    Report(Diag::InvalidOpcode, instr.opcode, hot.pc - 2);
+    hot.pc = START_ADDRESS;
+}
+
+// Counted per machine; the logger decides whether it is worth printing
+void Chip8::Report(Diag diag, uint16_t a, uint16_t b) {
+    ++effects;
+    ++diagnostics[static_cast<unsigned int>(diag)];
+    Logger::Instance().Report(diag, a, b);
 }
 
 void Chip8::Reset() {
-    pc = START_ADDRESS;
-    sp = 0;
-    opcode = 0;
-    index = 0;
-    memset(registers, 0, sizeof(registers));
-    memset(stack, 0, sizeof(stack));
+    hot.pc = START_ADDRESS;
+    hot.sp = 0;
+    instr = Instruction{};
+    hot.index = 0;
+    memset(hot.registers, 0, sizeof(hot.registers));
+    memset(hot.stack, 0, sizeof(hot.stack));
 }
 
 void Chip8::Table0() {
-    uint8_t op_low = opcode & 0x000Fu;
-    if (op_low > 0xF || !table0[op_low]) {
+    uint8_t op_low = instr.opcode & 0x000Fu;
+    if (op_low > 0xF || !dispatch.table0[op_low]) {
         HandleInvalidOpcode();
         return;
     }
-    ((*this).*(table0[op_low]))();
+    ((*this).*(dispatch.table0[op_low]))();
 }
 
 void Chip8::Table8() {
-    uint8_t op_low = opcode & 0x000Fu;
-    if (op_low > 0xF || !table8[op_low]) {
+    uint8_t op_low = instr.opcode & 0x000Fu;
+    if (op_low > 0xF || !dispatch.table8[op_low]) {
         HandleInvalidOpcode();
         return;
     }
-    ((*this).*(table8[op_low]))();
+    ((*this).*(dispatch.table8[op_low]))();
 }
 
 void Chip8::TableE() {
-    uint8_t op_low = opcode & 0x000Fu;
-    if (op_low > 0xF || !tableE[op_low]) {
+    uint8_t op_low = instr.opcode & 0x000Fu;
+    if (op_low > 0xF || !dispatch.tableE[op_low]) {
         HandleInvalidOpcode();
         return;
     }
-    ((*this).*(tableE[op_low]))();
+    ((*this).*(dispatch.tableE[op_low]))();
 }
 
 void Chip8::TableF() {
-    uint8_t op_low = opcode & 0x00FFu;
-    if (op_low > 0x65 || !tableF[op_low]) {
+    uint8_t op_low = instr.opcode & 0x00FFu;
+    if (op_low > 0x65 || !dispatch.tableF[op_low]) {
         HandleInvalidOpcode();
         return;
     }
-    ((*this).*(tableF[op_low]))();
+    ((*this).*(dispatch.tableF[op_low]))();
 }
 
 void Chip8::OP_NULL() {
-    static int invalidCount = 0;
-    if (++invalidCount > 10) {
-        std::cerr << "TOO MANY INVALID OPS! Resetting...\n";
+    if (++hot.invalidCount > 10) {
+        Report(Diag::TooManyInvalidOps);
         Reset();
-        invalidCount = 0;
+        hot.invalidCount = 0;
     }
 }
 
-Chip8::Chip8() 
-    : randGen(std::chrono::system_clock::now().time_since_epoch().count())
-{
-    pc = START_ADDRESS;
-    opcode = 0;
-    index = 0;
-    sp = 0;
-    delayTimer = 0;
-    soundTimer = 0;
-    drawFlag = false;
-    
-    memset(registers, 0, sizeof(registers));
-    memset(stack, 0, sizeof(stack));
-    memset(memory, 0, sizeof(memory));
-    memset(video, 0, sizeof(video));
-    memset(keypad, 0, sizeof(keypad));
-
-    for (unsigned int i=0; i<FONTSET_SIZE; ++i) {
-        memory[FONTSET_START_ADDRESS + i] = fontset[i];
-    }
-
-    randByte = std::uniform_int_distribution<uint8_t>(0, 255U);
+constexpr Chip8::Dispatch Chip8::MakeDispatch() {
+    Dispatch d{};
 
     for (int i = 0; i <= 0xF; i++) {
-        table[i] = &Chip8::OP_NULL;
+        d.table[i] = &Chip8::OP_NULL;
+        d.table0[i] = &Chip8::OP_NULL;
+        d.table8[i] = &Chip8::OP_NULL;
+        d.tableE[i] = &Chip8::OP_NULL;
     }
-    
-    for (int i = 0; i <= 0xF; i++) {
-        table0[i] = &Chip8::OP_NULL;
-        table8[i] = &Chip8::OP_NULL; 
-        tableE[i] = &Chip8::OP_NULL;
-    }
-    
+
     for (int i = 0; i <= 0x65; i++) {
-        tableF[i] = &Chip8::OP_NULL;
-    }
-
-    table[0x0] = &Chip8::Table0;
-    table[0x1] = &Chip8::OP_1nnn;
-    table[0x2] = &Chip8::OP_2nnn;
-    table[0x3] = &Chip8::OP_3xkk;
-    table[0x4] = &Chip8::OP_4xkk;
-    table[0x5] = &Chip8::OP_5xy0;
-    table[0x6] = &Chip8::OP_6xkk;
-    table[0x7] = &Chip8::OP_7xkk;
-    table[0x8] = &Chip8::Table8;
-    table[0x9] = &Chip8::OP_9xy0;
-    table[0xA] = &Chip8::OP_Annn;
-    table[0xB] = &Chip8::OP_Bnnn;
-    table[0xC] = &Chip8::OP_Cxkk;
-    table[0xD] = &Chip8::OP_Dxyn;
-    table[0xE] = &Chip8::TableE;
-    table[0xF] = &Chip8::TableF;
-
-    table0[0x0] = &Chip8::OP_00E0;
-    table0[0xE] = &Chip8::OP_00EE;
-
-    table8[0x0] = &Chip8::OP_8xy0;
-    table8[0x1] = &Chip8::OP_8xy1;
-    table8[0x2] = &Chip8::OP_8xy2;
-    table8[0x3] = &Chip8::OP_8xy3;
-    table8[0x4] = &Chip8::OP_8xy4;
-    table8[0x5] = &Chip8::OP_8xy5;
-    table8[0x6] = &Chip8::OP_8xy6;
-    table8[0x7] = &Chip8::OP_8xy7;
-    table8[0xE] = &Chip8::OP_8xyE;
-
-    tableE[0x1] = &Chip8::OP_ExA1;
-    tableE[0xE] = &Chip8::OP_Ex9E;
-
-    tableF[0x07] = &Chip8::OP_Fx07;
-    tableF[0x0A] = &Chip8::OP_Fx0A;
-    tableF[0x15] = &Chip8::OP_Fx15;
-    tableF[0x18] = &Chip8::OP_Fx18;
-    tableF[0x1E] = &Chip8::OP_Fx1E;
-    tableF[0x29] = &Chip8::OP_Fx29;
-    tableF[0x33] = &Chip8::OP_Fx33;
-    tableF[0x55] = &Chip8::OP_Fx55;
-    tableF[0x65] = &Chip8::OP_Fx65;
+        d.tableF[i] = &Chip8::OP_NULL;
+    }
+
+    d.table[0x0] = &Chip8::Table0;
+    d.table[0x1] = &Chip8::OP_1nnn;
+    d.table[0x2] = &Chip8::OP_2nnn;
+    d.table[0x3] = &Chip8::OP_3xkk;
+    d.table[0x4] = &Chip8::OP_4xkk;
+    d.table[0x5] = &Chip8::OP_5xy0;
+    d.table[0x6] = &Chip8::OP_6xkk;
+    d.table[0x7] = &Chip8::OP_7xkk;
+    d.table[0x8] = &Chip8::Table8;
+    d.table[0x9] = &Chip8::OP_9xy0;
+    d.table[0xA] = &Chip8::OP_Annn;
+    d.table[0xB] = &Chip8::OP_Bnnn;
+    d.table[0xC] = &Chip8::OP_Cxkk;
+    d.table[0xD] = &Chip8::OP_Dxyn;
+    d.table[0xE] = &Chip8::TableE;
+    d.table[0xF] = &Chip8::TableF;
+
+    d.table0[0x0] = &Chip8::OP_00E0;
+    d.table0[0xE] = &Chip8::OP_00EE;
+
+    d.table8[0x0] = &Chip8::OP_8xy0;
+    d.table8[0x1] = &Chip8::OP_8xy1;
+    d.table8[0x2] = &Chip8::OP_8xy2;
+    d.table8[0x3] = &Chip8::OP_8xy3;
+    d.table8[0x4] = &Chip8::OP_8xy4;
+    d.table8[0x5] = &Chip8::OP_8xy5;
+    d.table8[0x6] = &Chip8::OP_8xy6;
+    d.table8[0x7] = &Chip8::OP_8xy7;
+    d.table8[0xE] = &Chip8::OP_8xyE;
+
+    d.tableE[0x1] = &Chip8::OP_ExA1;
+    d.tableE[0xE] = &Chip8::OP_Ex9E;
+
+    d.tableF[0x07] = &Chip8::OP_Fx07;
+    d.tableF[0x0A] = &Chip8::OP_Fx0A;
+    d.tableF[0x15] = &Chip8::OP_Fx15;
+    d.tableF[0x18] = &Chip8::OP_Fx18;
+    d.tableF[0x1E] = &Chip8::OP_Fx1E;
+    d.tableF[0x29] = &Chip8::OP_Fx29;
+    d.tableF[0x33] = &Chip8::OP_Fx33;
+    d.tableF[0x55] = &Chip8::OP_Fx55;
+    d.tableF[0x65] = &Chip8::OP_Fx65;
+
+    return d;
+}
+
+// Built at compile time, so there is nothing to set up per instance
+const Chip8::Dispatch Chip8::dispatch = Chip8::MakeDispatch();
+
+// Every other field starts zeroed by its initializer
+Chip8::Chip8()
+{
+    hot.randState = std::chrono::system_clock::now().time_since_epoch().count() | 1;
+    memcpy(&memory[FONTSET_START_ADDRESS], fontset, FONTSET_SIZE);
 }
 
 void Chip8::OP_00E0() {
     memset(video, 0, sizeof(video));
+    dirtyRows = ~0u;
 }
 
 void Chip8::OP_00EE() {
-    if (sp == 0) {
-        std::cerr << "Stack underflow at 00EE!\n";
+    if (hot.sp == 0) {
+        Report(Diag::StackUnderflow, hot.pc - 2);
         Reset();
         return;
     }
-    --sp;
-    pc = stack[sp];
+    --hot.sp;
+    hot.pc = hot.stack[hot.sp];
 }
 
 void Chip8::OP_1nnn() {
-    uint16_t address = opcode & 0x0FFFu;
+    uint16_t address = instr.nnn;
     if (address >= 0x200 && address < 0xFFF) {
-        pc = address;
+        idleJump = address < hot.pc;
+        hot.pc = address;
     } else {
-        pc += 2;
+        hot.pc += 2;
     }
 }
 
 void Chip8::OP_2nnn() {
-    uint16_t address = opcode & 0x0FFFu;
-    stack[sp] = pc;
-    ++sp;
-    pc = address;
+    if (hot.sp >= STACK_LEVELS) {
+        Report(Diag::StackOverflow, hot.pc - 2);
+        Reset();
+        return;
+    }
+
+    uint16_t address = instr.nnn;
+    hot.stack[hot.sp] = hot.pc;
+    ++hot.sp;
+    hot.pc = address;
 }
 
 void Chip8::OP_3xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = instr.x;
+    uint8_t byte = instr.kk;
 
-    if (registers[Vx] == byte) {
-        pc += 2;
+    if (hot.registers[Vx] == byte) {
+        hot.pc += 2;
     }
 }
 
 void Chip8::OP_4xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = instr.x;
+    uint8_t byte = instr.kk;
 
-    if (registers[Vx] != byte) {
-        pc += 2;
+    if (hot.registers[Vx] != byte) {
+        hot.pc += 2;
     }
 }
 
 void Chip8::OP_5xy0() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    if (registers[Vx] == registers[Vy]) {
-        pc += 2;
+    if (hot.registers[Vx] == hot.registers[Vy]) {
+        hot.pc += 2;
     }
 }
 
 void Chip8::OP_6xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = instr.x;
+    uint8_t byte = instr.kk;
 
-    registers[Vx] = byte;
+    hot.registers[Vx] = byte;
 }
 
 void Chip8::OP_7xkk() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = instr.x;
+    uint8_t byte = instr.kk;
 
-    registers[Vx] += byte;
+    hot.registers[Vx] += byte;
 }
 
 void Chip8::OP_8xy0() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    registers[Vx] = registers[Vy];
+    hot.registers[Vx] = hot.registers[Vy];
 }
 
 void Chip8::OP_8xy1() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    registers[Vx] |= registers[Vy];
+    hot.registers[Vx] |= hot.registers[Vy];
 }
 
 void Chip8::OP_8xy2() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    registers[Vx] &= registers[Vy];
+    hot.registers[Vx] &= hot.registers[Vy];
 }
 
 void Chip8::OP_8xy3() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    registers[Vx] ^= registers[Vy];
+    hot.registers[Vx] ^= hot.registers[Vy];
 }
 
 void Chip8::OP_8xy4() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    uint16_t sum = registers[Vx] + registers[Vy];
+    uint16_t sum = hot.registers[Vx] + hot.registers[Vy];
 
     if (sum > 255U) {
-        registers[0xF] = 1;
+        hot.registers[0xF] = 1;
     } else {
-        registers[0xF] = 0;
+        hot.registers[0xF] = 0;
     }
-    registers[Vx] = sum & 0xFFu;
+    hot.registers[Vx] = sum & 0xFFu;
 }
 
 void Chip8::OP_8xy5() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    if (registers[Vx] > registers[Vy]) {
-        registers[0xF] = 1;
+    if (hot.registers[Vx] > hot.registers[Vy]) {
+        hot.registers[0xF] = 1;
     } else {
-        registers[0xF] = 0;
+        hot.registers[0xF] = 0;
     }
-    registers[Vx] -= registers[Vy];
+    hot.registers[Vx] -= hot.registers[Vy];
 }
 
 void Chip8::OP_8xy6() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = instr.x;
 
-    registers[0xF] = (registers[Vx] & 0x1u);
+    hot.registers[0xF] = (hot.registers[Vx] & 0x1u);
 
-    registers[Vx] >>= 1;
+    hot.registers[Vx] >>= 1;
 }
 
 void Chip8::OP_8xy7() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    if (registers[Vy] > registers[Vx]) {
-        registers[0xF] = 1;
+    if (hot.registers[Vy] > hot.registers[Vx]) {
+        hot.registers[0xF] = 1;
     } else {
-        registers[0xF] = 0;
+        hot.registers[0xF] = 0;
     }
-    registers[Vx] = registers[Vy] - registers[Vx];
+    hot.registers[Vx] = hot.registers[Vy] - hot.registers[Vx];
 }
 
 void Chip8::OP_8xyE() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = instr.x;
 
-    registers[0xF] = (registers[Vx] & 0x80u) >> 7u;
+    hot.registers[0xF] = (hot.registers[Vx] & 0x80u) >> 7u;
 
-    registers[Vx] <<= 1;
+    hot.registers[Vx] <<= 1;
 }
 
 void Chip8::OP_9xy0() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
 
-    if (registers[Vx] != registers[Vy]) {
-        pc += 2;
+    if (hot.registers[Vx] != hot.registers[Vy]) {
+        hot.pc += 2;
     }
 }
 
 void Chip8::OP_Annn() {
-    uint16_t address = opcode & 0x0FFFu;
-    index = address;
+    uint16_t address = instr.nnn;
+    hot.index = address;
 }
 
 void Chip8::OP_Bnnn() {
-    uint16_t address = opcode & 0x0FFFu;
-    pc = address + registers[0];
+    uint16_t address = instr.nnn;
+    hot.pc = address + hot.registers[0];
 }
 
 void Chip8::OP_Cxkk() {
-    uint8_t Vx = (opcode & 0x0F00) >> 8u;
-    uint8_t byte = opcode & 0x00FFu;
+    uint8_t Vx = instr.x;
+    uint8_t byte = instr.kk;
 
-    registers[Vx] = randByte(randGen) & byte;
+    hot.registers[Vx] = RandomByte() & byte;
 }
 
 void Chip8::OP_Dxyn() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t Vy = (opcode & 0x00F0u) >> 4u;
-    uint8_t height = opcode & 0x000Fu;
+    uint8_t Vx = instr.x;
+    uint8_t Vy = instr.y;
+    uint8_t height = instr.kk & 0x000Fu;
 
-    if (index + height >= MEMORY_SIZE) {
-        std::cerr << "DRAW: Invalid sprite memory access\n";
+    if (hot.index + height >= MEMORY_SIZE) {
+        Report(Diag::SpriteOutOfBounds, hot.index);
         return;
     }
 
-    uint8_t xPos = registers[Vx] % VIDEO_WIDTH;
-    uint8_t yPos = registers[Vy] % VIDEO_HEIGHT;
+    uint8_t xPos = hot.registers[Vx] % VIDEO_WIDTH;
+    uint8_t yPos = hot.registers[Vy] % VIDEO_HEIGHT;
 
-    registers[0xF] = 0;
+    ++effects;
+    hot.registers[0xF] = 0;
     bool pixelChanged = false;
 
-    for (unsigned int row = 0; row < height; ++row) {
-        uint8_t spriteByte = memory[index + row];
+    for (unsigned int row = 0; row < height && yPos + row < VIDEO_HEIGHT; ++row) {
+        // Column 0 is the top bit; columns past the right edge shift out
+        uint64_t spriteRow = (static_cast<uint64_t>(memory[hot.index + row]) << 56u) >> xPos;
+        uint64_t& screenRow = video[yPos + row];
 
-        for (unsigned int col = 0; col < 8; ++col) {
-            if (xPos + col >= VIDEO_WIDTH || yPos + row >= VIDEO_HEIGHT)
-                continue;
-
-            uint8_t spritePixel = spriteByte & (0x80u >> col);
-            uint8_t* screenPixel = &video[(yPos + row) * VIDEO_WIDTH + (xPos + col)];
+        if (screenRow & spriteRow) {
+            hot.registers[0xF] = 1;
+        }
 
-            if (spritePixel) {
-                if (*screenPixel == 1)
-                    registers[0xF] = 1;
+        screenRow ^= spriteRow;
 
-                *screenPixel ^= 1;
-                pixelChanged = true;
-            }
+        if (spriteRow) {
+            dirtyRows |= 1u << (yPos + row);
+            pixelChanged = true;
         }
     }
     drawFlag = pixelChanged;
 }
 
 void Chip8::OP_Ex9E() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t key = registers[Vx];
+    uint8_t Vx = instr.x;
+    uint8_t key = hot.registers[Vx];
 
-    if (keypad[key]) {
-        pc += 2;
+    if (key < KEY_COUNT && keypad[key]) {
+        hot.pc += 2;
     }
 }
 
 void Chip8::OP_ExA1() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t key = registers[Vx];
+    uint8_t Vx = instr.x;
+    uint8_t key = hot.registers[Vx];
 
-    if (!keypad[key]) {
-        pc += 2;
+    if (key >= KEY_COUNT || !keypad[key]) {
+        hot.pc += 2;
     }
 }
 
 void Chip8::OP_Fx07() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    registers[Vx] = delayTimer;
+    uint8_t Vx = instr.x;
+    hot.registers[Vx] = hot.delayTimer;
 }
 
 void Chip8::OP_Fx0A() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = instr.x;
 
     if (keypad[0]) {
-        registers[Vx] = 0;
+        hot.registers[Vx] = 0;
     } else if (keypad[1]) {
-        registers[Vx] = 1;
+        hot.registers[Vx] = 1;
     } else if (keypad[2]) {
-        registers[Vx] = 2;
+        hot.registers[Vx] = 2;
     } else if (keypad[3]) {
-        registers[Vx] = 3;
+        hot.registers[Vx] = 3;
     } else if (keypad[4]) {
-        registers[Vx] = 4;
+        hot.registers[Vx] = 4;
     } else if (keypad[5]) {
-        registers[Vx] = 5;
+        hot.registers[Vx] = 5;
     } else if (keypad[6]) {
-        registers[Vx] = 6;
+        hot.registers[Vx] = 6;
     } else if (keypad[7]) {
-        registers[Vx] = 7;
+        hot.registers[Vx] = 7;
     } else if (keypad[8]) {
-        registers[Vx] = 8;
+        hot.registers[Vx] = 8;
     } else if (keypad[9]) {
-        registers[Vx] = 9;
+        hot.registers[Vx] = 9;
     } else if (keypad[10]) {
-        registers[Vx] = 10;
+        hot.registers[Vx] = 10;
     } else if (keypad[11]) {
-        registers[Vx] = 11;
+        hot.registers[Vx] = 11;
     } else if (keypad[12]) {
-        registers[Vx] = 12;
+        hot.registers[Vx] = 12;
     } else if (keypad[13]) {
-        registers[Vx] = 13;
+        hot.registers[Vx] = 13;
     } else if (keypad[14]) {
-        registers[Vx] = 14;
+        hot.registers[Vx] = 14;
     } else if (keypad[15]) {
-        registers[Vx] = 15;
+        hot.registers[Vx] = 15;
     } else {
-        pc -= 2;
+        hot.pc -= 2;
+        idleJump = true;
     }
 }
 
 void Chip8::OP_Fx15() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    delayTimer = registers[Vx];
+    uint8_t Vx = instr.x;
+    hot.delayTimer = hot.registers[Vx];
 }
 
 void Chip8::OP_Fx18() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    soundTimer = registers[Vx];
+    uint8_t Vx = instr.x;
+    hot.soundTimer = hot.registers[Vx];
 }
 
 void Chip8::OP_Fx1E() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint16_t oldIndex = index;
-    index += registers[Vx];
+    uint8_t Vx = instr.x;
+    uint16_t oldIndex = hot.index;
+    hot.index += hot.registers[Vx];
     
-    if (index < oldIndex || index >= MEMORY_SIZE) {
-        std::cerr << "Index register overflow: 0x" << std::hex << index << "\n";
-        index %= MEMORY_SIZE;
+    if (hot.index < oldIndex || hot.index >= MEMORY_SIZE) {
+        Report(Diag::IndexOverflow, hot.index);
+        hot.index %= MEMORY_SIZE;
     }
     
-    if (index < FONTSET_START_ADDRESS) {
-        index = FONTSET_START_ADDRESS;
+    if (hot.index < FONTSET_START_ADDRESS) {
+        hot.index = FONTSET_START_ADDRESS;
     }
 }
 
 void Chip8::OP_Fx29() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t digit = registers[Vx] & 0x0F;  
-    index = FONTSET_START_ADDRESS + (5 * digit);
+    uint8_t Vx = instr.x;
+    uint8_t digit = hot.registers[Vx] & 0x0F;  
+    hot.index = FONTSET_START_ADDRESS + (5 * digit);
 }
 
 void Chip8::OP_Fx33() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
-    uint8_t value = registers[Vx];
+    uint8_t Vx = instr.x;
+    uint8_t value = hot.registers[Vx];
+
+    if (hot.index + 2u >= MEMORY_SIZE) {
+        Report(Diag::StoreOutOfBounds, hot.index);
+        return;
+    }
 
-    memory[index + 2] = value % 10;
+    memory[hot.index + 2] = value % 10;
     value /= 10;
 
-    memory[index + 1] = value % 10;
+    memory[hot.index + 1] = value % 10;
     value /= 10;
 
-    memory[index] = value % 10;
+    memory[hot.index] = value % 10;
+    ++effects;
+    ++memoryWrites;
 }
 
 void Chip8::OP_Fx55() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = instr.x;
     
-    if ((index + Vx) >= MEMORY_SIZE) {
-        std::cerr << "ERROR: Memory store out of bounds\n";
+    if ((hot.index + Vx) >= MEMORY_SIZE) {
+        Report(Diag::StoreOutOfBounds, hot.index);
         return;
     }
     
     for (uint8_t i = 0; i <= Vx; ++i) {
-        memory[index + i] = registers[i];
+        memory[hot.index + i] = hot.registers[i];
     }
+    ++effects;
+    ++memoryWrites;
 }
 
 void Chip8::OP_Fx65() {
-    uint8_t Vx = (opcode & 0x0F00u) >> 8u;
+    uint8_t Vx = instr.x;
 
-    if ((index + Vx) >= MEMORY_SIZE) {
-        std::cerr << "ERROR: Memory store out of bounds\n";
+    if ((hot.index + Vx) >= MEMORY_SIZE) {
+        Report(Diag::LoadOutOfBounds, hot.index);
         return;
     }
 
     for (uint8_t i=0; i <= Vx; ++i) {
-        registers[i] = memory[index + i];
+        hot.registers[i] = memory[hot.index + i];
     }
 }
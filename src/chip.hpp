@@ -1,6 +1,9 @@
 #pragma once
-#include <random>
+#include "log.hpp"
+#include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#include <vector>
 
 const unsigned int VIDEO_WIDTH = 64;
 const unsigned int VIDEO_HEIGHT = 32;
@@ -9,33 +12,155 @@ const unsigned int START_ADDRESS = 0x200;
 const unsigned int REGISTER_COUNT = 16;
 const unsigned int KEY_COUNT = 16;
 const unsigned int STACK_LEVELS = 16;
+const unsigned int FONTSET_SIZE = 80;
+const unsigned int FONTSET_START_ADDRESS = 0x50;
+const unsigned int HOT_STATE_SIZE = 64;
+
+// Instruction dispatch strategy used by Cycle() and Run()
+enum class Core : uint8_t {
+    Table,   // legacy member-function-pointer tables
+    Switch,  // single switch, handlers inlined into the loop
+    Cached,  // switch over instructions pre-decoded once per process
+};
+
+// Handler id of a decoded instruction
+enum class Op : uint8_t {
+    Op00E0, Op00EE, Op1nnn, Op2nnn, Op3xkk, Op4xkk, Op5xy0, Op6xkk, Op7xkk,
+    Op8xy0, Op8xy1, Op8xy2, Op8xy3, Op8xy4, Op8xy5, Op8xy6, Op8xy7, Op8xyE,
+    Op9xy0, OpAnnn, OpBnnn, OpCxkk, OpDxyn, OpEx9E, OpExA1,
+    OpFx07, OpFx0A, OpFx15, OpFx18, OpFx1E, OpFx29, OpFx33, OpFx55, OpFx65,
+    Null,     // unassigned slot, handled by OP_NULL
+    Invalid,  // rejected by HandleInvalidOpcode
+};
+
+const unsigned int OP_COUNT = static_cast<unsigned int>(Op::Invalid) + 1;
+
+char const* OpName(Op op);
+
+// Set CHIP8_PROFILER=0 to compile the profiler and trace hooks out entirely
+#ifndef CHIP8_PROFILER
+#define CHIP8_PROFILER 1
+#endif
+
+const bool PROFILER_COMPILED = CHIP8_PROFILER != 0;
+
+class Profiler;
+class TraceWriter;
+
+// Opcode with its operands already extracted
+struct Instruction {
+    uint16_t opcode;
+    uint16_t nnn;
+    Op op;
+    uint8_t x;
+    uint8_t y;
+    uint8_t kk;
+};
+
+const uint32_t STATE_MAGIC = 0x38504843;   // "CHP8" little-endian
+const uint16_t STATE_VERSION = 1;
+
+// Complete machine state as plain data, so a snapshot is a handful of
+// copies and can be written to disk byte for byte. Fields are ordered
+// largest first so the layout has no padding.
+struct Chip8State {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t keys;                     // bit n = key n held
+    uint64_t randState;
+    uint64_t video[VIDEO_HEIGHT];
+    uint16_t index;
+    uint16_t pc;
+    uint16_t stack[STACK_LEVELS];
+    uint8_t sp;
+    uint8_t delayTimer;
+    uint8_t soundTimer;
+    uint8_t invalidCount;
+    uint8_t registers[REGISTER_COUNT];
+    uint8_t memory[MEMORY_SIZE];
+};
+
+static_assert(std::is_trivially_copyable<Chip8State>::value, "Chip8State must be plain data");
+static_assert(sizeof(Chip8State) == 4424, "Chip8State layout changed, bump STATE_VERSION");
+
+// Everything a typical instruction touches, in one cache line. Idle-loop
+// detection compares and copies it as a whole, so it must have no padding.
+struct HotState {
+    uint8_t registers[REGISTER_COUNT]{};
+    uint16_t index{};
+    uint16_t pc{START_ADDRESS};
+    uint16_t stack[STACK_LEVELS]{};
+    uint8_t sp{};
+    uint8_t delayTimer{};
+    uint8_t soundTimer{};
+    uint8_t invalidCount{};           // OP_NULL hits since the last reset they caused
+    uint64_t randState{};
+};
+
+static_assert(sizeof(HotState) == HOT_STATE_SIZE, "hot state must fill exactly one cache line");
+static_assert(std::has_unique_object_representations<HotState>::value, "hot state must have no padding");
 
 class Chip8 {
 
     public:
         uint8_t keypad[KEY_COUNT]{};
-        uint8_t video[VIDEO_WIDTH * VIDEO_HEIGHT]{};
+        uint64_t video[VIDEO_HEIGHT]{};   // one row per word, column 0 in the top bit
         bool drawFlag{false};
+        uint32_t dirtyRows{~0u};          // rows changed since the consumer last cleared it
         
         Chip8();
-        void LoadROM(char const* filename);
+        bool LoadROM(char const* filename);
+        bool LoadROM(uint8_t const* data, size_t size);
         void Cycle();
+        void Run(uint64_t cycles);
+        void TickTimers();
+        void SetKeys(uint16_t mask);      // bit n = key n held
+        void SaveState(Chip8State& state) const;
+        bool LoadState(Chip8State const& state);
+        void Seed(uint64_t seed);         // makes Cxkk reproducible
+        void SetProfiler(Profiler* newProfiler) { profiler = newProfiler; }
+        void SetTracer(TraceWriter* newTracer) { tracer = newTracer; }
+        uint64_t StateHash() const;
+        void SetCore(Core newCore);
+        Core GetCore() const { return core; }
         void HandleInvalidOpcode();
         void Reset();
+        uint64_t Diagnostics(Diag diag) const { return diagnostics[static_cast<unsigned int>(diag)]; }
+        bool Buzzing() const { return buzzing; }   // sound timer was running in the frame TickTimers() ended
+        void SetIdleSkip(bool enabled) { idleSkip = enabled; }
+        uint64_t IdleCycles() const { return idleCycles; }    // skipped by Run() as idle loop iterations
+
+        uint8_t const* Memory() const { return memory; }
+        bool Pixel(unsigned int x, unsigned int y) const { return (video[y] >> (63u - x)) & 1u; }
+        void ExpandVideo(uint8_t* pixels) const;
+
+        static Instruction Decode(uint16_t opcode);
+        static uint16_t StoreLength(uint16_t opcode);
+        static uint64_t HashState(Chip8State const& state);
+        static uint64_t SeedState(uint64_t seed);    // RNG state Seed() starts from
 
     private:
-        uint8_t registers[REGISTER_COUNT]{};
+        friend class Jit;
+        friend class AotRunner;
+
+        alignas(64) HotState hot;
+
+        bool buzzing{};
+        bool idleSkip{true};
+        bool idleJump{};                  // set by jumps back and by Fx0A waiting; see RunLoop()
+        uint32_t effects{};               // stores, draws and reports, which end an idle loop
+        uint64_t idleCycles{};
+        Instruction instr{};
+        Core core{Core::Switch};
+        uint32_t codeEpoch{};             // renewed, unique across machines, whenever memory is replaced wholesale
+        uint32_t memoryWrites{};          // bumped by every store instruction, for translated code
+        Profiler* profiler{};             // null unless profiling
+        TraceWriter* tracer{};            // null unless tracing
+        uint64_t diagnostics[DIAG_COUNT]{};
         uint8_t memory[MEMORY_SIZE]{};
-        uint16_t index{};
-        uint16_t pc{};
-        uint16_t stack[STACK_LEVELS]{};
-        uint8_t sp{};
-        uint8_t delayTimer{};
-        uint8_t soundTimer{};
-        uint16_t opcode;
 
-        std::default_random_engine randGen;
-	    std::uniform_int_distribution<uint8_t> randByte;
+        uint8_t RandomByte();
+        void Report(Diag diag, uint16_t a = 0, uint16_t b = 0);
 
         void OP_00E0();
         void OP_00EE();
@@ -72,6 +197,12 @@ class Chip8 {
         void OP_Fx55();
         void OP_Fx65();
 
+        void CycleTable();
+        void CycleSwitch();
+        void CycleCached(Instruction const* decoded);
+        void RunInstrumented(uint64_t cycles);
+        template <typename Step> void RunLoop(uint64_t cycles, Step step);
+
         void Table0();
         void Table8();
         void TableE();
@@ -79,15 +210,27 @@ class Chip8 {
 
         void OP_NULL();
 
+        // Shared by every instance; see CycleTable()
         typedef void (Chip8::*Chip8Func)();
-            Chip8Func table[16];      
-            Chip8Func table0[16];    
-            Chip8Func table8[16];     
-            Chip8Func tableE[16];     
-            Chip8Func tableF[0x66];   
+        struct Dispatch {
+            Chip8Func table[16];
+            Chip8Func table0[16];
+            Chip8Func table8[16];
+            Chip8Func tableE[16];
+            Chip8Func tableF[0x66];
+        };
+        static const Dispatch dispatch;
+        static constexpr Dispatch MakeDispatch();
 
+        // Decode() of every opcode, for Core::Cached
+        static Instruction const* DecodeTable();
 };
 
+// No heap state and no per-instance tables, so copying a machine (to fork a
+// search, say) is one memcpy of a few KB. A Jit or AotRunner running the
+// machine assigned to must be flushed afterwards.
+static_assert(std::is_trivially_copyable<Chip8>::value, "Chip8 must stay plain data");
+
 template <typename T>
 constexpr const T& clamp(const T& v, const T& lo, const T& hi) {
     return (v < lo) ? lo : (hi < v) ? hi : v;
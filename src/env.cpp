@@ -0,0 +1,203 @@
+#include "env.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+
+// Eight 0/1 pixel bytes for each byte of a packed row, in column order
+static uint64_t const* PixelBytes() {
+    static std::array<uint64_t, 256> const table = [] {
+        std::array<uint64_t, 256> bytes{};
+        for (unsigned int value = 0; value < 256; ++value) {
+            uint8_t pixels[8];
+            for (unsigned int bit = 0; bit < 8; ++bit) {
+                pixels[bit] = (value >> (7u - bit)) & 1u;
+            }
+            memcpy(&bytes[value], pixels, sizeof(pixels));
+        }
+        return bytes;
+    }();
+    return table.data();
+}
+
+Chip8Env::Chip8Env(unsigned int envs, EnvOptions const& options)
+    : options(options),
+      machines(std::max(1u, envs)),
+      scores(machines.size()),
+      frames(machines.size()),
+      episodes(machines.size())
+{
+    this->options.frameskip = std::max(1u, options.frameskip);
+    this->options.cyclesPerFrame = std::max(1u, options.cyclesPerFrame);
+    prototype.SetCore(options.core);
+
+    if (options.threads != 1) {
+        pool = std::make_unique<ThreadPool>(options.threads);
+    }
+}
+
+bool Chip8Env::LoadROM(uint8_t const* data, size_t size) {
+    RewardSpec const& reward = options.reward;
+
+    if (reward.format != ScoreFormat::None &&
+        (reward.scoreLength == 0 || reward.scoreAddress + reward.scoreLength > MEMORY_SIZE)) {
+        std::cerr << "ERROR: Score at " << reward.scoreAddress << " (" << static_cast<int>(reward.scoreLength)
+                  << " bytes) is outside memory\n";
+        return false;
+    }
+    if ((reward.format == ScoreFormat::Binary && reward.scoreLength > MAX_BINARY_SCORE_BYTES) ||
+        (reward.format == ScoreFormat::Digits && reward.scoreLength > MAX_DIGITS_SCORE_BYTES)) {
+        std::cerr << "ERROR: Score of " << static_cast<int>(reward.scoreLength) << " bytes does not fit in 64 bits\n";
+        return false;
+    }
+    if (reward.doneAddress >= static_cast<int32_t>(MEMORY_SIZE)) {
+        std::cerr << "ERROR: Done flag at " << reward.doneAddress << " is outside memory\n";
+        return false;
+    }
+
+    if (!prototype.LoadROM(data, size)) {
+        return false;
+    }
+
+    std::fill(machines.begin(), machines.end(), prototype);
+    return true;
+}
+
+void Chip8Env::Reset(uint64_t newSeed, uint8_t* newObservations) {
+    seed = newSeed;
+    observations = newObservations;
+    std::fill(episodes.begin(), episodes.end(), 0);
+    ForEachChunk(&Chip8Env::ResetRange);
+}
+
+void Chip8Env::Step(uint16_t const* newActions, uint8_t* newObservations, float* newRewards, uint8_t* newDones) {
+    actions = newActions;
+    observations = newObservations;
+    rewards = newRewards;
+    dones = newDones;
+    ForEachChunk(&Chip8Env::StepRange);
+}
+
+uint64_t Chip8Env::Episodes() const {
+    uint64_t total = 0;
+    for (uint64_t count : episodes) {
+        total += count;
+    }
+    return total;
+}
+
+// Splits the environments into one contiguous range per worker. The task
+// only captures this and the chunk number, which std::function stores
+// without allocating.
+void Chip8Env::ForEachChunk(void (Chip8Env::*body)(unsigned int, unsigned int)) {
+    if (!pool) {
+        (this->*body)(0, Envs());
+        return;
+    }
+
+    chunkBody = body;
+    unsigned int chunks = std::min(pool->Size(), Envs());
+
+    for (unsigned int chunk = 0; chunk < chunks; ++chunk) {
+        pool->Submit([this, chunk, chunks] {
+            unsigned int first = static_cast<unsigned int>(uint64_t(Envs()) * chunk / chunks);
+            unsigned int last = static_cast<unsigned int>(uint64_t(Envs()) * (chunk + 1) / chunks);
+            (this->*chunkBody)(first, last);
+        });
+    }
+    pool->Wait();
+}
+
+void Chip8Env::ResetRange(unsigned int first, unsigned int last) {
+    for (unsigned int env = first; env < last; ++env) {
+        ResetEnv(env);
+        Observe(env);
+    }
+}
+
+void Chip8Env::StepRange(unsigned int first, unsigned int last) {
+    for (unsigned int env = first; env < last; ++env) {
+        Chip8& chip = machines[env];
+        chip.SetKeys(actions[env]);
+
+        // A game over part way through the skip ends the step there
+        bool done = false;
+        for (unsigned int frame = 0; frame < options.frameskip && !done; ++frame) {
+            chip.Run(options.cyclesPerFrame);
+            chip.TickTimers();
+            ++frames[env];
+            done = Done(env);
+        }
+
+        int64_t score = Score(chip);
+        rewards[env] = static_cast<float>(score - scores[env]);
+        scores[env] = score;
+        dones[env] = done ? 1 : 0;
+
+        if (done) {
+            ++episodes[env];
+            ResetEnv(env);
+        }
+        Observe(env);
+    }
+}
+
+// The copy is a memcpy, so a reset costs about as much as one frame
+void Chip8Env::ResetEnv(unsigned int env) {
+    Chip8& chip = machines[env];
+    chip = prototype;
+    chip.Seed(seed + env + episodes[env] * Envs());
+    frames[env] = 0;
+    scores[env] = Score(chip);
+}
+
+int64_t Chip8Env::Score(Chip8 const& chip) const {
+    RewardSpec const& reward = options.reward;
+    uint8_t const* bytes = chip.Memory() + reward.scoreAddress;
+
+    // Unsigned so a digit byte above 9 wraps instead of overflowing
+    uint64_t score = 0;
+
+    switch (reward.format) {
+        case ScoreFormat::None:
+            break;
+        case ScoreFormat::Binary:
+            for (unsigned int i = 0; i < reward.scoreLength; ++i) {
+                score = (score << 8) | bytes[i];
+            }
+            break;
+        case ScoreFormat::Digits:
+            for (unsigned int i = 0; i < reward.scoreLength; ++i) {
+                score = score * 10 + bytes[i];
+            }
+            break;
+    }
+    return static_cast<int64_t>(score);
+}
+
+bool Chip8Env::Done(unsigned int env) const {
+    RewardSpec const& reward = options.reward;
+
+    if (reward.maxFrames > 0 && frames[env] >= reward.maxFrames) {
+        return true;
+    }
+    return reward.doneAddress >= 0 && machines[env].Memory()[reward.doneAddress] == reward.doneValue;
+}
+
+void Chip8Env::Observe(unsigned int env) {
+    Chip8 const& chip = machines[env];
+    uint8_t* out = observations + env * ObservationSize();
+
+    if (options.format == ObsFormat::Packed) {
+        memcpy(out, chip.video, OBS_PACKED_SIZE);
+        return;
+    }
+
+    uint64_t const* table = PixelBytes();
+    for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y) {
+        uint64_t row = chip.video[y];
+        for (unsigned int i = 0; i < VIDEO_WIDTH / 8; ++i, out += 8) {
+            memcpy(out, &table[(row >> (56u - 8u * i)) & 0xFFu], 8);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include "chip.hpp"
+#include "scheduler.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Observation layout, per environment
+enum class ObsFormat : uint8_t {
+    Packed,   // VIDEO_HEIGHT uint64 rows exactly as Chip8::video, 256 bytes
+    Bytes,    // one byte per pixel, 0 or 1, row-major, 2048 bytes
+};
+
+const size_t OBS_PACKED_SIZE = VIDEO_HEIGHT * sizeof(uint64_t);
+const size_t OBS_BYTES_SIZE = VIDEO_WIDTH * VIDEO_HEIGHT;
+
+// Longest score that still fits the int64_t it is accumulated in
+const unsigned int MAX_BINARY_SCORE_BYTES = 8;
+const unsigned int MAX_DIGITS_SCORE_BYTES = 18;
+
+// How the score is stored in RAM
+enum class ScoreFormat : uint8_t {
+    None,     // no reward
+    Binary,   // scoreLength bytes, big-endian, at most MAX_BINARY_SCORE_BYTES
+    Digits,   // one decimal digit per byte, most significant first, as Fx33 writes it;
+              // at most MAX_DIGITS_SCORE_BYTES
+};
+
+// Per-ROM description of where a game keeps its score and game-over flag.
+// The reward for a step is how much the score grew during it.
+struct RewardSpec {
+    ScoreFormat format{ScoreFormat::None};
+    uint16_t scoreAddress{};
+    uint8_t scoreLength{1};
+    int32_t doneAddress{-1};          // episode ends when memory[doneAddress] == doneValue; -1 = never
+    uint8_t doneValue{};
+    uint32_t maxFrames{};             // episodes are cut after this many frames, 0 = no limit
+};
+
+struct EnvOptions {
+    unsigned int frameskip{4};        // frames run per Step(), holding the same keys
+    unsigned int cyclesPerFrame{DEFAULT_CYCLES_PER_FRAME};
+    ObsFormat format{ObsFormat::Packed};
+    Core core{Core::Switch};
+    unsigned int threads{1};          // 0 = one per hardware thread
+    RewardSpec reward;
+};
+
+// A batch of independent machines running one ROM, driven like a
+// reinforcement-learning environment. Every call writes its results into
+// caller-provided arrays, one entry (or one observation) per environment.
+// The environment's own buffers are sized once; only the thread pool's
+// task queues may allocate while stepping with threads. An environment
+// whose episode ends is reset on the spot: Step() reports done = 1 with
+// the final reward, and the observation is already the first one of the
+// next episode.
+class Chip8Env {
+
+    public:
+        Chip8Env(unsigned int envs, EnvOptions const& options = {});
+
+        bool LoadROM(uint8_t const* data, size_t size);
+
+        unsigned int Envs() const { return static_cast<unsigned int>(machines.size()); }
+        size_t ObservationSize() const { return options.format == ObsFormat::Packed ? OBS_PACKED_SIZE : OBS_BYTES_SIZE; }
+
+        // Restarts every environment; environment i's episodes are seeded
+        // from seed, i and the episode number, so runs are reproducible
+        void Reset(uint64_t seed, uint8_t* observations);
+
+        // actions[i] is the key mask held by environment i (bit n = key n)
+        void Step(uint16_t const* actions, uint8_t* observations, float* rewards, uint8_t* dones);
+
+        Chip8 const& Machine(unsigned int env) const { return machines[env]; }
+        uint64_t Episodes() const;    // finished so far, over all environments
+
+    private:
+        EnvOptions options;
+        Chip8 prototype;              // freshly loaded machine every reset copies
+        std::vector<Chip8> machines;
+        std::vector<int64_t> scores;
+        std::vector<uint32_t> frames;
+        std::vector<uint64_t> episodes;
+        uint64_t seed{};
+
+        std::unique_ptr<ThreadPool> pool;
+
+        // Arguments of the Step() in progress, for the workers
+        uint16_t const* actions{};
+        uint8_t* observations{};
+        float* rewards{};
+        uint8_t* dones{};
+        void (Chip8Env::*chunkBody)(unsigned int, unsigned int){};
+
+        void ForEachChunk(void (Chip8Env::*body)(unsigned int, unsigned int));
+        void ResetRange(unsigned int first, unsigned int last);
+        void StepRange(unsigned int first, unsigned int last);
+        void ResetEnv(unsigned int env);
+        int64_t Score(Chip8 const& chip) const;
+        bool Done(unsigned int env) const;
+        void Observe(unsigned int env);
+};
@@ -0,0 +1,142 @@
+#include "chip.hpp"
+#include "input_log.hpp"
+#include "manifest.hpp"
+#include "scheduler.hpp"
+#include "thread_pool.hpp"
+#include "video.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs many independent machines in parallel. Each manifest line is one
+// job (see manifest.hpp). Results are printed as one JSON object per line
+// in the order jobs finish.
+
+static std::string JsonString(std::string const& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc % 2 == 1) {
+        std::cerr << "Usage: " << argv[0] << " <Manifest> [--threads N] [--core table|switch|cached] [--ipf N]\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    unsigned int threads = 0;
+    Core core = Core::Switch;
+    unsigned int cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+
+        if (option == "--threads") {
+            threads = std::stoul(value);
+        } else if (option == "--core" && value == "table") {
+            core = Core::Table;
+        } else if (option == "--core" && value == "switch") {
+            core = Core::Switch;
+        } else if (option == "--core" && value == "cached") {
+            core = Core::Cached;
+        } else if (option == "--ipf") {
+            cyclesPerFrame = std::max(1, std::stoi(value));
+        } else {
+            std::cerr << "Unknown option: " << option << " " << value << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    std::vector<ManifestJob> jobs;
+    ManifestFiles files;
+    if (!ParseManifest(argv[1], jobs) || !files.Load(jobs)) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Thousands of machines executing garbage would otherwise all compete
+    // for the log; the per-job counters below still see everything
+    Logger::Instance().SetLevel(Severity::Off);
+
+    std::mutex outMutex;
+    uint64_t totalInstructions = 0;
+    ThreadPool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+
+    for (ManifestJob const& job : jobs) {
+        pool.Submit([&, job] {
+            std::vector<uint8_t> const& rom = files.roms.at(job.rom);
+            InputLog const* log = job.log.empty() ? nullptr : &files.logs.at(job.log);
+
+            Chip8 chip;
+            chip.SetCore(core);
+            bool loaded = chip.LoadROM(rom.data(), rom.size());
+
+            uint64_t seed = job.seedFromLog ? log->seed : job.seed;
+            uint64_t frames = job.framesFromLog ? log->frames : job.frames;
+            uint64_t ipf = log ? log->cyclesPerFrame : cyclesPerFrame;
+            chip.Seed(seed);
+
+            if (loaded && log) {
+                size_t cursor = 0;
+                for (uint64_t frame = 0; frame < frames; ++frame) {
+                    log->PlayFrame(chip, frame, cursor, [&](uint64_t count) { chip.Run(count); });
+                }
+            } else if (loaded) {
+                for (uint64_t frame = 0; frame < frames; ++frame) {
+                    chip.Run(ipf);
+                    chip.TickTimers();
+                }
+            }
+
+            // Idle loop iterations Run() fast-forwarded were never executed
+            uint64_t executed = loaded ? frames * ipf - chip.IdleCycles() : 0;
+
+            std::ostringstream line;
+            line << "{\"job\": " << job.id << ", \"rom\": " << JsonString(job.rom)
+                 << ", \"seed\": " << seed << ", \"frames\": " << frames
+                 << ", \"instructions\": " << executed << ", \"idle_cycles\": " << chip.IdleCycles()
+                 << ", \"loaded\": " << (loaded ? "true" : "false")
+                 << ", \"state_hash\": \"" << std::hex << std::setfill('0') << std::setw(16) << chip.StateHash()
+                 << "\", \"video_hash\": \"" << std::setw(16) << HashVideo(chip.video) << "\", \"diagnostics\": {" << std::dec;
+
+            bool first = true;
+            for (unsigned int i = 0; i < DIAG_COUNT; ++i) {
+                Diag diag = static_cast<Diag>(i);
+                if (chip.Diagnostics(diag) > 0) {
+                    line << (first ? "" : ", ") << "\"" << DiagName(diag) << "\": " << chip.Diagnostics(diag);
+                    first = false;
+                }
+            }
+            line << "}}\n";
+
+            std::lock_guard<std::mutex> lock(outMutex);
+            fputs(line.str().c_str(), stdout);
+            fflush(stdout);
+            totalInstructions += executed;
+        });
+    }
+
+    pool.Wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << "jobs: " << jobs.size() << "\n"
+              << "threads: " << pool.Size() << "\n"
+              << "seconds: " << seconds << "\n"
+              << "instructions/sec: " << static_cast<uint64_t>(seconds > 0.0 ? totalInstructions / seconds : 0.0) << "\n";
+
+    return 0;
+}
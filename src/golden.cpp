@@ -0,0 +1,360 @@
+#include "chip.hpp"
+#include "input_log.hpp"
+#include "manifest.hpp"
+#include "thread_pool.hpp"
+#include "video.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Golden-frame regression runner. Runs every job of a manifest (see
+// manifest.hpp) headlessly and hashes the framebuffer, and optionally the
+// full machine state, every N frames and after the last one. With
+// --update on the results become the golden file; otherwise they are
+// compared against it, and each job that changed gets a diff image of
+// its first mismatching checkpoint.
+//
+// Golden file, one checkpoint per line:
+//   <ROM> <InputLog|-> <Seed> <Frame> <VideoHash> <StateHash|-> <Video>
+// Video is the framebuffer as 32 rows of 16 hex digits, so a mismatch can
+// be drawn without the build that produced the golden file.
+
+const unsigned int DEFAULT_CHECKPOINT_INTERVAL = 60;   // one per emulated second
+const unsigned int DIFF_SCALE = 4;
+const unsigned int DIFF_GUTTER = 4;                     // pixels between the panels
+
+struct Checkpoint {
+    uint64_t frame;
+    uint64_t videoHash;
+    uint64_t stateHash;
+    bool hasState;
+    uint64_t video[VIDEO_HEIGHT];
+};
+
+struct JobResult {
+    bool loaded;
+    uint64_t seed;
+    std::vector<Checkpoint> checkpoints;
+};
+
+static std::string CheckpointKey(ManifestJob const& job, uint64_t seed, uint64_t frame) {
+    return job.rom + " " + (job.log.empty() ? "-" : job.log) + " " + std::to_string(seed) + " " + std::to_string(frame);
+}
+
+static bool LoadGolden(char const* filename, std::map<std::string, Checkpoint>& golden) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "ERROR: Failed to open golden file " << filename << " (create it with --update on)\n";
+        return false;
+    }
+
+    std::string line;
+    unsigned int lineNumber = 0;
+
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string rom, log, seed, frame, videoHash, stateHash, video;
+
+        if (!(fields >> rom) || rom[0] == '#') {
+            continue;
+        }
+
+        if (!(fields >> log >> seed >> frame >> videoHash >> stateHash >> video) || video.size() != VIDEO_HEIGHT * 16) {
+            std::cerr << "ERROR: " << filename << ":" << lineNumber
+                      << ": expected <ROM> <InputLog|-> <Seed> <Frame> <VideoHash> <StateHash|-> <Video>\n";
+            return false;
+        }
+
+        Checkpoint checkpoint{};
+        try {
+            checkpoint.frame = std::stoull(frame);
+            checkpoint.videoHash = std::stoull(videoHash, nullptr, 16);
+            checkpoint.hasState = stateHash != "-";
+            checkpoint.stateHash = checkpoint.hasState ? std::stoull(stateHash, nullptr, 16) : 0;
+            for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+                checkpoint.video[row] = std::stoull(video.substr(row * 16, 16), nullptr, 16);
+            }
+        } catch (std::exception const&) {
+            std::cerr << "ERROR: " << filename << ":" << lineNumber << ": invalid number\n";
+            return false;
+        }
+
+        golden[rom + " " + log + " " + seed + " " + frame] = checkpoint;
+    }
+
+    return true;
+}
+
+static bool SaveGolden(char const* filename, std::vector<ManifestJob> const& jobs, std::vector<JobResult> const& results) {
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "ERROR: Failed to open golden file " << filename << " for writing\n";
+        return false;
+    }
+
+    file << "# <ROM> <InputLog|-> <Seed> <Frame> <VideoHash> <StateHash|-> <Video>\n" << std::hex << std::setfill('0');
+
+    for (ManifestJob const& job : jobs) {
+        JobResult const& result = results[job.id];
+
+        for (Checkpoint const& checkpoint : result.checkpoints) {
+            file << CheckpointKey(job, result.seed, checkpoint.frame) << " " << std::setw(16) << checkpoint.videoHash << " ";
+            if (checkpoint.hasState) {
+                file << std::setw(16) << checkpoint.stateHash << " ";
+            } else {
+                file << "- ";
+            }
+            for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+                file << std::setw(16) << checkpoint.video[row];
+            }
+            file << "\n";
+        }
+    }
+
+    return file.good();
+}
+
+// Binary PPM of three panels side by side: the golden frame, the frame
+// produced now, and their difference, where red pixels were only lit in
+// the golden frame and green ones are only lit now
+static bool WriteDiffImage(std::string const& filename, uint64_t const* expected, uint64_t const* actual) {
+    unsigned int panelWidth = VIDEO_WIDTH * DIFF_SCALE;
+    unsigned int width = 3 * panelWidth + 2 * DIFF_GUTTER;
+    unsigned int height = VIDEO_HEIGHT * DIFF_SCALE;
+    std::vector<uint8_t> pixels(width * height * 3, 64);
+
+    auto paint = [&](unsigned int panel, unsigned int x, unsigned int y, uint8_t r, uint8_t g, uint8_t b) {
+        for (unsigned int dy = 0; dy < DIFF_SCALE; ++dy) {
+            uint8_t* out = &pixels[((y * DIFF_SCALE + dy) * width + panel * (panelWidth + DIFF_GUTTER) + x * DIFF_SCALE) * 3];
+            for (unsigned int dx = 0; dx < DIFF_SCALE; ++dx, out += 3) {
+                out[0] = r;
+                out[1] = g;
+                out[2] = b;
+            }
+        }
+    };
+
+    for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y) {
+        for (unsigned int x = 0; x < VIDEO_WIDTH; ++x) {
+            bool was = (expected[y] >> (63u - x)) & 1u;
+            bool is = (actual[y] >> (63u - x)) & 1u;
+            paint(0, x, y, was ? 255 : 0, was ? 255 : 0, was ? 255 : 0);
+            paint(1, x, y, is ? 255 : 0, is ? 255 : 0, is ? 255 : 0);
+
+            if (was && is) {
+                paint(2, x, y, 96, 96, 96);
+            } else {
+                paint(2, x, y, was ? 255 : 0, is ? 255 : 0, 0);
+            }
+        }
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR: Failed to open " << filename << " for writing\n";
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<char const*>(pixels.data()), pixels.size());
+    return file.good();
+}
+
+static std::string Hex(uint64_t value) {
+    std::ostringstream text;
+    text << std::hex << std::setfill('0') << std::setw(16) << value;
+    return text.str();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc % 2 == 0) {
+        std::cerr << "Usage: " << argv[0] << " <Manifest> <Golden> [--update on|off] [--state on|off] [--every N]"
+                  << " [--diff Dir] [--threads N] [--core table|switch|cached] [--ipf N]\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    char const* goldenFilename = argv[2];
+    bool update = false;
+    bool hashState = false;
+    uint64_t every = DEFAULT_CHECKPOINT_INTERVAL;
+    std::string diffDir = "golden-diff";
+    unsigned int threads = 0;
+    Core core = Core::Switch;
+    unsigned int cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+
+        if (option == "--update") {
+            update = value == "on";
+        } else if (option == "--state") {
+            hashState = value == "on";
+        } else if (option == "--every") {
+            every = std::max(1ull, std::stoull(value));
+        } else if (option == "--diff") {
+            diffDir = value;
+        } else if (option == "--threads") {
+            threads = std::stoul(value);
+        } else if (option == "--core" && value == "table") {
+            core = Core::Table;
+        } else if (option == "--core" && value == "switch") {
+            core = Core::Switch;
+        } else if (option == "--core" && value == "cached") {
+            core = Core::Cached;
+        } else if (option == "--ipf") {
+            cyclesPerFrame = std::max(1, std::stoi(value));
+        } else {
+            std::cerr << "Unknown option: " << option << " " << value << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    std::vector<ManifestJob> jobs;
+    ManifestFiles files;
+    if (!ParseManifest(argv[1], jobs) || !files.Load(jobs)) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::map<std::string, Checkpoint> golden;
+    if (!update && !LoadGolden(goldenFilename, golden)) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    // Broken ROMs would otherwise have every worker contending for the log
+    Logger::Instance().SetLevel(Severity::Off);
+
+    std::vector<JobResult> results(jobs.size());
+    ThreadPool pool(threads);
+    auto start = std::chrono::steady_clock::now();
+
+    for (ManifestJob const& job : jobs) {
+        pool.Submit([&, job] {
+            std::vector<uint8_t> const& rom = files.roms.at(job.rom);
+            InputLog const* log = job.log.empty() ? nullptr : &files.logs.at(job.log);
+            JobResult& result = results[job.id];
+
+            Chip8 chip;
+            chip.SetCore(core);
+            result.loaded = chip.LoadROM(rom.data(), rom.size());
+
+            result.seed = job.seedFromLog ? log->seed : job.seed;
+            uint64_t frames = job.framesFromLog ? log->frames : job.frames;
+            uint64_t ipf = log ? log->cyclesPerFrame : cyclesPerFrame;
+            chip.Seed(result.seed);
+
+            auto checkpoint = [&](uint64_t frame) {
+                Checkpoint taken{frame, HashVideo(chip.video), hashState ? chip.StateHash() : 0, hashState, {}};
+                std::copy(std::begin(chip.video), std::end(chip.video), taken.video);
+                result.checkpoints.push_back(taken);
+            };
+
+            size_t cursor = 0;
+            for (uint64_t frame = 0; result.loaded && frame < frames; ++frame) {
+                if (log) {
+                    log->PlayFrame(chip, frame, cursor, [&](uint64_t count) { chip.Run(count); });
+                } else {
+                    chip.Run(ipf);
+                    chip.TickTimers();
+                }
+
+                if ((frame + 1) % every == 0) {
+                    checkpoint(frame + 1);
+                }
+            }
+
+            if (result.checkpoints.empty() || result.checkpoints.back().frame != frames) {
+                checkpoint(frames);
+            }
+        });
+    }
+
+    pool.Wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t checkpoints = 0;
+    for (JobResult const& result : results) {
+        checkpoints += result.checkpoints.size();
+    }
+
+    if (update) {
+        for (ManifestJob const& job : jobs) {
+            if (!results[job.id].loaded) {
+                std::cerr << "WARNING: " << job.rom << " did not load; its golden frames are blank\n";
+            }
+        }
+        if (!SaveGolden(goldenFilename, jobs, results)) {
+            std::exit(EXIT_FAILURE);
+        }
+        std::cerr << "wrote " << checkpoints << " checkpoints for " << jobs.size() << " jobs to " << goldenFilename << "\n"
+                  << "seconds: " << seconds << "\n";
+        return 0;
+    }
+
+    // Results are reported in manifest order, one line per failing job
+    size_t failed = 0;
+    bool diffDirReady = false;
+
+    for (ManifestJob const& job : jobs) {
+        JobResult const& result = results[job.id];
+        std::ostringstream failure;
+
+        if (!result.loaded) {
+            failure << "ROM did not load";
+        }
+
+        for (size_t i = 0; i < result.checkpoints.size() && failure.tellp() == 0; ++i) {
+            Checkpoint const& actual = result.checkpoints[i];
+            auto found = golden.find(CheckpointKey(job, result.seed, actual.frame));
+
+            if (found == golden.end()) {
+                failure << "frame " << actual.frame << ": no golden checkpoint";
+                break;
+            }
+
+            Checkpoint const& expected = found->second;
+            if (actual.videoHash != expected.videoHash) {
+                failure << "frame " << actual.frame << ": video " << Hex(actual.videoHash) << ", expected " << Hex(expected.videoHash);
+
+                std::error_code error;
+                if (!diffDirReady) {
+                    std::filesystem::create_directories(diffDir, error);
+                    diffDirReady = true;
+                }
+
+                std::string image = diffDir + "/" + std::to_string(job.id) + "-"
+                                  + std::filesystem::path(job.rom).stem().string() + "-f" + std::to_string(actual.frame) + ".ppm";
+                if (WriteDiffImage(image, expected.video, actual.video)) {
+                    failure << ", diff " << image;
+                }
+            } else if (actual.hasState && expected.hasState && actual.stateHash != expected.stateHash) {
+                failure << "frame " << actual.frame << ": state " << Hex(actual.stateHash) << ", expected " << Hex(expected.stateHash);
+            }
+        }
+
+        if (failure.tellp() != 0) {
+            ++failed;
+            std::cout << "FAIL " << job.id << " " << job.rom << " seed " << result.seed << ": " << failure.str() << "\n";
+        }
+    }
+
+    std::cerr << "jobs: " << jobs.size() << "\n"
+              << "checkpoints: " << checkpoints << "\n"
+              << "passed: " << jobs.size() - failed << "\n"
+              << "failed: " << failed << "\n"
+              << "threads: " << pool.Size() << "\n"
+              << "seconds: " << seconds << "\n";
+
+    return failed == 0 ? 0 : EXIT_FAILURE;
+}
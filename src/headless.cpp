@@ -0,0 +1,202 @@
+#include "audio.hpp"
+#include "chip.hpp"
+#include "input_log.hpp"
+#include "jit.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc % 2 == 0) {
+        std::cerr << "Usage: " << argv[0] << " <ROM> <Cycles> [--core table|switch|cached|jit] [--ipf N] [--seed N] [--replay Log]"
+                  << " [--profile Out.json] [--folded Out.folded] [--trace Out.c8t] [--trace-compress lz|none]"
+                  << " [--log warning|error|off] [--idle on|off] [--audio null|Out.wav]\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    char const* romFilename = argv[1];
+    uint64_t cycles = std::stoull(argv[2]);
+
+    Chip8 chip8;
+    bool useJit = false;
+    unsigned int cyclesPerFrame = DEFAULT_CYCLES_PER_FRAME;
+    InputLog replay;
+    bool replaying = false;
+    std::string profileFilename;
+    std::string foldedFilename;
+    std::string traceFilename;
+    bool traceCompress = true;
+    std::string audioFilename;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        std::string value = argv[i + 1];
+
+        if (option == "--core" && value == "table") {
+            chip8.SetCore(Core::Table);
+        } else if (option == "--core" && value == "switch") {
+            chip8.SetCore(Core::Switch);
+        } else if (option == "--core" && value == "cached") {
+            chip8.SetCore(Core::Cached);
+        } else if (option == "--core" && value == "jit") {
+            useJit = true;
+        } else if (option == "--ipf") {
+            cyclesPerFrame = std::max(1, std::stoi(value));
+        } else if (option == "--seed") {
+            chip8.Seed(std::stoull(value));
+        } else if (option == "--replay") {
+            if (!replay.Load(value.c_str())) {
+                std::exit(EXIT_FAILURE);
+            }
+            replaying = true;
+        } else if (option == "--profile") {
+            profileFilename = value;
+        } else if (option == "--folded") {
+            foldedFilename = value;
+        } else if (option == "--trace") {
+            traceFilename = value;
+        } else if (option == "--trace-compress" && (value == "lz" || value == "none")) {
+            traceCompress = value == "lz";
+        } else if (option == "--log" && value == "warning") {
+            Logger::Instance().SetLevel(Severity::Warning);
+        } else if (option == "--log" && value == "error") {
+            Logger::Instance().SetLevel(Severity::Error);
+        } else if (option == "--log" && value == "off") {
+            Logger::Instance().SetLevel(Severity::Off);
+        } else if (option == "--audio") {
+            audioFilename = value;
+        } else if (option == "--idle" && (value == "on" || value == "off")) {
+            chip8.SetIdleSkip(value == "on");
+        } else {
+            std::cerr << "Unknown option: " << option << " " << value << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!chip8.LoadROM(romFilename)) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::unique_ptr<Profiler> profiler;
+    TraceWriter tracer;
+    bool instrumented = !profileFilename.empty() || !foldedFilename.empty() || !traceFilename.empty();
+
+    if (instrumented && !PROFILER_COMPILED) {
+        std::cerr << "ERROR: Built with CHIP8_PROFILER=OFF\n";
+        std::exit(EXIT_FAILURE);
+    }
+    if (!profileFilename.empty() || !foldedFilename.empty()) {
+        profiler = std::make_unique<Profiler>();
+        chip8.SetProfiler(profiler.get());
+    }
+    if (!traceFilename.empty()) {
+        if (!tracer.Open(traceFilename.c_str(), traceCompress)) {
+            std::exit(EXIT_FAILURE);
+        }
+        chip8.SetTracer(&tracer);
+    }
+
+    Jit jit;
+    auto run = [&](uint64_t count) {
+        if (useJit) {
+            jit.Run(chip8, count);
+        } else {
+            chip8.Run(count);
+        }
+    };
+
+    // A replay brings its own seed and frame size and runs to its end
+    if (replaying) {
+        chip8.Seed(replay.seed);
+        cyclesPerFrame = replay.cyclesPerFrame;
+        cycles = replay.frames * cyclesPerFrame;
+    }
+
+    // The buzzer is rendered in step with the frames: "null" only
+    // exercises it, anything else is written out as a .wav file
+    Buzzer buzzer;
+    WavWriter wav;
+    std::vector<int16_t> samples(buzzer.SampleRate() / FRAME_RATE);
+    uint64_t audioFrames = 0;
+
+    if (!audioFilename.empty() && audioFilename != "null" && !wav.Open(audioFilename.c_str(), buzzer.SampleRate())) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    auto renderAudio = [&] {
+        if (!audioFilename.empty()) {
+            buzzer.Update(audioFrames++, chip8.Buzzing());
+            buzzer.Render(samples.data(), samples.size());
+            wav.Write(samples.data(), samples.size());
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (replaying) {
+        size_t cursor = 0;
+        for (uint64_t frame = 0; frame < replay.frames; ++frame) {
+            replay.PlayFrame(chip8, frame, cursor, run);
+            renderAudio();
+        }
+    } else {
+        // Timers tick once per frame of cyclesPerFrame instructions
+        for (uint64_t remaining = cycles; remaining > 0;) {
+            uint64_t batch = std::min<uint64_t>(remaining, cyclesPerFrame);
+            run(batch);
+            chip8.TickTimers();
+            renderAudio();
+            remaining -= batch;
+        }
+    }
+
+    tracer.Close();
+    wav.Close();
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double ips = seconds > 0.0 ? cycles / seconds : 0.0;
+
+    std::cout << "cycles: " << cycles << "\n"
+              << "seconds: " << seconds << "\n"
+              << "instructions/sec: " << static_cast<uint64_t>(ips) << "\n"
+              << "state hash: " << std::hex << std::setw(16) << std::setfill('0') << chip8.StateHash() << "\n" << std::dec;
+
+    if (chip8.IdleCycles() > 0) {
+        std::cout << "idle cycles skipped: " << chip8.IdleCycles() << "\n";
+    }
+    if (!audioFilename.empty()) {
+        AudioStats audio = buzzer.Stats();
+        std::cout << "audio frames: " << audioFrames << ", buzzer transitions: " << audio.transitions
+                  << ", dropped: " << audio.dropped << ", late: " << audio.late << "\n";
+    }
+
+    // Counted even when rate limiting or --log kept them off stderr
+    Logger::Instance().Flush();
+    for (unsigned int i = 0; i < DIAG_COUNT; ++i) {
+        Diag diag = static_cast<Diag>(i);
+        if (chip8.Diagnostics(diag) > 0) {
+            std::cout << DiagName(diag) << ": " << chip8.Diagnostics(diag) << "\n";
+        }
+    }
+    if (Logger::Instance().Dropped() > 0) {
+        std::cout << "log messages dropped: " << Logger::Instance().Dropped() << "\n";
+    }
+
+    if (profiler && !profileFilename.empty()) {
+        profiler->WriteJson(profileFilename.c_str());
+    }
+    if (profiler && !foldedFilename.empty()) {
+        profiler->WriteFolded(foldedFilename.c_str());
+    }
+
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "input.hpp"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+uint64_t InputClock() {
+    return SDL_GetPerformanceCounter();
+}
+
+double InputClockMs(uint64_t ticks) {
+    return ticks * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+KeyMap::KeyMap()
+    : keys{SDLK_x, SDLK_1, SDLK_2, SDLK_3, SDLK_q, SDLK_w, SDLK_e, SDLK_a,
+           SDLK_s, SDLK_d, SDLK_z, SDLK_c, SDLK_4, SDLK_r, SDLK_f, SDLK_v}
+{
+}
+
+static std::string Trim(std::string const& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool KeyMap::Load(char const* filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open key map " << filename << "\n";
+        return false;
+    }
+
+    // Entries are only applied once the whole file has parsed
+    SDL_Keycode loaded[KEY_COUNT];
+    std::copy(std::begin(keys), std::end(keys), loaded);
+
+    std::string line;
+    for (unsigned int number = 1; std::getline(file, line); ++number) {
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        std::string key = Trim(line.substr(0, equals));
+        std::string name = equals == std::string::npos ? "" : Trim(line.substr(equals + 1));
+
+        if (key.size() != 1 || !isxdigit(static_cast<unsigned char>(key[0]))) {
+            std::cerr << "ERROR: " << filename << ":" << number << ": expected a CHIP-8 key 0-F\n";
+            return false;
+        }
+
+        SDL_Keycode sym = SDL_GetKeyFromName(name.c_str());
+        if (sym == SDLK_UNKNOWN) {
+            std::cerr << "ERROR: " << filename << ":" << number << ": unknown key name '" << name << "'\n";
+            return false;
+        }
+
+        loaded[std::stoi(key, nullptr, 16)] = sym;
+    }
+
+    std::copy(std::begin(loaded), std::end(loaded), keys);
+    return true;
+}
+
+int KeyMap::Find(SDL_Keycode sym) const {
+    for (unsigned int key = 0; key < KEY_COUNT; ++key) {
+        if (keys[key] == sym) {
+            return static_cast<int>(key);
+        }
+    }
+    return -1;
+}
+
+LatencyStats LatencyRecorder::Stats() const {
+    if (samples.empty()) {
+        return {};
+    }
+
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double ms : sorted) {
+        sum += ms;
+    }
+
+    auto percentile = [&](double p) { return sorted[static_cast<size_t>(p * (sorted.size() - 1))]; };
+    return {sorted.size(), sum / sorted.size(), percentile(0.5), percentile(0.99), sorted.back()};
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "chip.hpp"
+#include "spsc_queue.hpp"
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const size_t KEY_EVENT_QUEUE_SIZE = 64;      // keypad changes in flight between two frames
+const size_t LATENCY_SAMPLES = 1 << 16;      // key presses kept for the latency report
+
+// Input timestamps are ticks of SDL's high-resolution performance counter
+uint64_t InputClock();
+double InputClockMs(uint64_t ticks);
+
+// The whole keypad after one key went down or up, stamped when it was polled
+struct KeyEvent {
+    uint64_t time;
+    uint16_t keys;      // bit n = key n held
+};
+
+// Window thread to emulation thread
+using KeyEventQueue = SpscQueue<KeyEvent, KEY_EVENT_QUEUE_SIZE>;
+
+// Host key for each CHIP-8 key. Starts out as the usual 1234/QWER/ASDF/ZXCV
+// block; Load() overrides entries from a text file of lines such as
+//   A = Z
+//   C = Keypad 4
+// with a hex CHIP-8 key on the left and an SDL key name on the right.
+// '#' starts a comment.
+class KeyMap {
+
+    public:
+        KeyMap();
+
+        bool Load(char const* filename);
+
+        // CHIP-8 key for a host key, or -1 if unmapped
+        int Find(SDL_Keycode sym) const;
+
+    private:
+        SDL_Keycode keys[KEY_COUNT];
+};
+
+struct LatencyStats {
+    size_t count;
+    double meanMs;
+    double p50Ms;
+    double p99Ms;
+    double maxMs;
+};
+
+// Latency samples in milliseconds. Storage is reserved up front, so Add()
+// never allocates; samples past LATENCY_SAMPLES are not kept.
+class LatencyRecorder {
+
+    public:
+        LatencyRecorder() { samples.reserve(LATENCY_SAMPLES); }
+
+        void Add(double ms) {
+            if (samples.size() < LATENCY_SAMPLES) {
+                samples.push_back(ms);
+            }
+        }
+
+        LatencyStats Stats() const;
+
+    private:
+        std::vector<double> samples;
+};
@@ -0,0 +1,120 @@
+#include "input_log.hpp"
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+static void PutFixed(std::vector<uint8_t>& out, uint64_t value, unsigned int bytes) {
+    for (unsigned int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static void PutVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool GetFixed(std::vector<uint8_t> const& in, size_t& pos, uint64_t& value, unsigned int bytes) {
+    if (in.size() - pos < bytes) {
+        return false;
+    }
+    value = 0;
+    for (unsigned int i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[pos++]) << (8 * i);
+    }
+    return true;
+}
+
+static bool GetVarint(std::vector<uint8_t> const& in, size_t& pos, uint64_t& value) {
+    value = 0;
+    for (unsigned int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint8_t byte = in[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void InputLog::Record(uint64_t frame, uint32_t instruction, uint16_t keys) {
+    if (keys == lastKeys) {
+        return;
+    }
+    events.push_back(InputEvent{frame, instruction, keys});
+    lastKeys = keys;
+}
+
+bool InputLog::Save(char const* filename) const {
+    std::vector<uint8_t> out;
+    PutFixed(out, INPUT_LOG_MAGIC, 4);
+    PutFixed(out, INPUT_LOG_VERSION, 2);
+    PutFixed(out, cyclesPerFrame, 4);
+    PutFixed(out, seed, 8);
+    PutVarint(out, frames);
+    PutVarint(out, events.size());
+
+    uint64_t previous = 0;
+    for (InputEvent const& event : events) {
+        PutVarint(out, event.frame - previous);
+        PutVarint(out, event.instruction);
+        PutFixed(out, event.keys, 2);
+        previous = event.frame;
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open input log for writing\n";
+        return false;
+    }
+    file.write(reinterpret_cast<char const*>(out.data()), out.size());
+    return file.good();
+}
+
+bool InputLog::Load(char const* filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open input log\n";
+        return false;
+    }
+
+    std::vector<uint8_t> in((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+    uint64_t magic, version, frameSize, count;
+
+    if (!GetFixed(in, pos, magic, 4) || magic != INPUT_LOG_MAGIC
+        || !GetFixed(in, pos, version, 2) || version != INPUT_LOG_VERSION) {
+        std::cerr << "ERROR: Not an input log or unsupported version\n";
+        return false;
+    }
+
+    if (!GetFixed(in, pos, frameSize, 4) || !GetFixed(in, pos, seed, 8)
+        || !GetVarint(in, pos, frames) || !GetVarint(in, pos, count)) {
+        std::cerr << "ERROR: Truncated input log\n";
+        return false;
+    }
+    cyclesPerFrame = static_cast<uint32_t>(frameSize);
+
+    events.clear();
+    uint64_t frame = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t delta, instruction, keys;
+        if (!GetVarint(in, pos, delta) || !GetVarint(in, pos, instruction) || !GetFixed(in, pos, keys, 2)) {
+            std::cerr << "ERROR: Truncated input log\n";
+            return false;
+        }
+        frame += delta;
+        events.push_back(InputEvent{frame, static_cast<uint32_t>(instruction), static_cast<uint16_t>(keys)});
+    }
+
+    if (pos != in.size()) {
+        std::cerr << "ERROR: Unexpected data after the input log's events\n";
+        return false;
+    }
+
+    lastKeys = events.empty() ? 0 : events.back().keys;
+    return true;
+}
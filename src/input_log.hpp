@@ -0,0 +1,62 @@
+#pragma once
+#include "chip.hpp"
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const uint32_t INPUT_LOG_MAGIC = 0x4E493843;   // "C8IN" little-endian
+const uint16_t INPUT_LOG_VERSION = 1;
+
+// Keypad changed to keys after the given number of instructions of a frame
+struct InputEvent {
+    uint64_t frame;
+    uint32_t instruction;
+    uint16_t keys;      // bit n = key n held
+};
+
+// Everything needed to reproduce a session from a freshly loaded ROM:
+// the RNG seed, the frame size and every keypad change. On disk events
+// are varint frame deltas, so an idle stretch costs nothing and a key
+// press a few bytes.
+class InputLog {
+
+    public:
+        uint64_t seed{};
+        uint32_t cyclesPerFrame{DEFAULT_CYCLES_PER_FRAME};
+        uint64_t frames{};                // length of the session
+        std::vector<InputEvent> events;
+
+        // Appends an event if keys differ from the last recorded state
+        void Record(uint64_t frame, uint32_t instruction, uint16_t keys);
+
+        bool Save(char const* filename) const;
+        bool Load(char const* filename);
+
+        // Runs one frame, applying its events at their instruction offsets.
+        // run(n) must execute exactly n instructions; cursor is the index
+        // of the next event and starts at 0.
+        template <typename RunFunc>
+        void PlayFrame(Chip8& chip, uint64_t frame, size_t& cursor, RunFunc run) const {
+            uint32_t done = 0;
+
+            while (cursor < events.size() && events[cursor].frame <= frame) {
+                InputEvent const& event = events[cursor++];
+                uint32_t at = event.frame < frame ? 0 : std::min(event.instruction, cyclesPerFrame);
+                if (at > done) {
+                    run(at - done);
+                    done = at;
+                }
+                chip.SetKeys(event.keys);
+            }
+
+            if (cyclesPerFrame > done) {
+                run(cyclesPerFrame - done);
+            }
+            chip.TickTimers();
+        }
+
+    private:
+        uint16_t lastKeys{};
+};
@@ -0,0 +1,423 @@
+#include "jit.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CHIP8_JIT_X64 1
+#endif
+
+#if defined(CHIP8_JIT_X64)
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+const size_t CODE_SIZE = 1 << 20;
+const size_t MAX_BLOCKS = 1 << 16;
+const uint32_t MAX_BLOCK_INSTRUCTIONS = 64;
+const size_t MAX_BLOCK_BYTES = MAX_BLOCK_INSTRUCTIONS * 64 + 128;
+const size_t CODE_PAGE = 4096;      // protection granularity on x86-64
+
+// Minimal x86-64 encoder. The Chip8 pointer lives in rdi, scratch registers
+// are eax/ecx/edx, and every field is addressed as [rdi + disp32].
+struct Emitter {
+    enum Reg : uint8_t { EAX = 0, ECX = 1, EDX = 2 };
+
+    std::vector<uint8_t> bytes;
+
+    void Byte(uint8_t b) { bytes.push_back(b); }
+
+    void Imm16(uint16_t v) {
+        Byte(v & 0xFFu);
+        Byte(v >> 8u);
+    }
+
+    void Imm32(uint32_t v) {
+        for (int i = 0; i < 4; ++i) {
+            Byte((v >> (8 * i)) & 0xFFu);
+        }
+    }
+
+    // ModRM for [rdi + disp32] with the given reg field
+    void Mem(uint8_t reg, int32_t disp) {
+        Byte(0x80u | (reg << 3u) | 0x07u);
+        Imm32(static_cast<uint32_t>(disp));
+    }
+
+    void Prologue() {
+#if defined(_WIN32)
+        Byte(0x57);                 // push rdi
+        Byte(0x48); Byte(0x89); Byte(0xCF);  // mov rdi, rcx
+#endif
+    }
+
+    void Epilogue() {
+#if defined(_WIN32)
+        Byte(0x5F);                 // pop rdi
+#endif
+        Byte(0xC3);                 // ret
+    }
+
+    void LoadByte(Reg r, int32_t disp) {       // movzx r32, byte [disp]
+        Byte(0x0F); Byte(0xB6); Mem(r, disp);
+    }
+
+    void StoreByte(int32_t disp, Reg r) {      // mov byte [disp], r8
+        Byte(0x88); Mem(r, disp);
+    }
+
+    void StoreByteImm(int32_t disp, uint8_t v) {
+        Byte(0xC6); Mem(0, disp); Byte(v);
+    }
+
+    void AddByteImm(int32_t disp, uint8_t v) {
+        Byte(0x80); Mem(0, disp); Byte(v);
+    }
+
+    void CmpByteImm(int32_t disp, uint8_t v) {
+        Byte(0x80); Mem(7, disp); Byte(v);
+    }
+
+    void CmpByte(Reg r, int32_t disp) {        // cmp r8, byte [disp]
+        Byte(0x3A); Mem(r, disp);
+    }
+
+    void StoreWordImm(int32_t disp, uint16_t v) {
+        Byte(0x66); Byte(0xC7); Mem(0, disp); Imm16(v);
+    }
+
+    void StoreWord(int32_t disp, Reg r) {
+        Byte(0x66); Byte(0x89); Mem(r, disp);
+    }
+
+    void MovImm(Reg r, uint32_t v) {
+        Byte(0xB8u + r); Imm32(v);
+    }
+
+    // Two-register byte ALU op on al, cl: opcode is the r/m8, r8 form
+    void AluAlCl(uint8_t op) {
+        Byte(op); Byte(0xC8);
+    }
+
+    void SetccDl(uint8_t cc) {
+        Byte(0x0F); Byte(0x90u + cc); Byte(0xC2);
+    }
+
+    void CmovccEdxEcx(uint8_t cc) {
+        Byte(0x0F); Byte(0x40u + cc); Byte(0xD1);
+    }
+};
+
+// Condition codes
+const uint8_t CC_B = 0x2;
+const uint8_t CC_E = 0x4;
+const uint8_t CC_NE = 0x5;
+const uint8_t CC_A = 0x7;
+
+// x86 ALU opcodes, r/m8, r8 form
+const uint8_t ALU_ADD = 0x00;
+const uint8_t ALU_OR = 0x08;
+const uint8_t ALU_AND = 0x20;
+const uint8_t ALU_SUB = 0x28;
+const uint8_t ALU_XOR = 0x30;
+const uint8_t ALU_CMP = 0x38;
+
+struct Offsets {
+    int32_t registers;
+    int32_t index;
+    int32_t pc;
+
+    int32_t V(uint8_t reg) const { return registers + reg; }
+};
+
+// Emits one non-branching instruction; false if it must be interpreted
+static bool EmitStraight(Emitter& e, Offsets const& o, Instruction const& in) {
+    int32_t vx = o.V(in.x);
+    int32_t vy = o.V(in.y);
+    int32_t vf = o.V(0xF);
+
+    switch (in.op) {
+        case Op::Op6xkk:
+            e.StoreByteImm(vx, in.kk);
+            return true;
+        case Op::Op7xkk:
+            e.AddByteImm(vx, in.kk);
+            return true;
+        case Op::OpAnnn:
+            e.StoreWordImm(o.index, in.nnn);
+            return true;
+        case Op::Op8xy0:
+            e.LoadByte(Emitter::EAX, vy);
+            e.StoreByte(vx, Emitter::EAX);
+            return true;
+        case Op::Op8xy1:
+        case Op::Op8xy2:
+        case Op::Op8xy3: {
+            uint8_t alu = in.op == Op::Op8xy1 ? ALU_OR : in.op == Op::Op8xy2 ? ALU_AND : ALU_XOR;
+            e.LoadByte(Emitter::EAX, vx);
+            e.LoadByte(Emitter::ECX, vy);
+            e.AluAlCl(alu);
+            e.StoreByte(vx, Emitter::EAX);
+            return true;
+        }
+        case Op::Op8xy4:
+            // Sum is taken before VF is written, Vx is written last
+            e.LoadByte(Emitter::EAX, vx);
+            e.LoadByte(Emitter::ECX, vy);
+            e.AluAlCl(ALU_ADD);
+            e.SetccDl(CC_B);
+            e.StoreByte(vf, Emitter::EDX);
+            e.StoreByte(vx, Emitter::EAX);
+            return true;
+        case Op::Op8xy5:
+        case Op::Op8xy7: {
+            // The interpreter writes VF before subtracting, so operands are
+            // reloaded in case x or y is VF
+            int32_t lhs = in.op == Op::Op8xy5 ? vx : vy;
+            int32_t rhs = in.op == Op::Op8xy5 ? vy : vx;
+            e.LoadByte(Emitter::EAX, lhs);
+            e.LoadByte(Emitter::ECX, rhs);
+            e.AluAlCl(ALU_CMP);
+            e.SetccDl(CC_A);
+            e.StoreByte(vf, Emitter::EDX);
+            e.LoadByte(Emitter::EAX, lhs);
+            e.LoadByte(Emitter::ECX, rhs);
+            e.AluAlCl(ALU_SUB);
+            e.StoreByte(vx, Emitter::EAX);
+            return true;
+        }
+        case Op::Op8xy6:
+            e.LoadByte(Emitter::EAX, vx);
+            e.Byte(0x24); e.Byte(0x01);                 // and al, 1
+            e.StoreByte(vf, Emitter::EAX);
+            e.LoadByte(Emitter::EAX, vx);
+            e.Byte(0xD0); e.Byte(0xE8);                 // shr al, 1
+            e.StoreByte(vx, Emitter::EAX);
+            return true;
+        case Op::Op8xyE:
+            e.LoadByte(Emitter::EAX, vx);
+            e.Byte(0xC0); e.Byte(0xE8); e.Byte(0x07);   // shr al, 7
+            e.StoreByte(vf, Emitter::EAX);
+            e.LoadByte(Emitter::EAX, vx);
+            e.Byte(0xD0); e.Byte(0xE0);                 // shl al, 1
+            e.StoreByte(vx, Emitter::EAX);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Emits a block-ending jump or skip; next is the address after the opcode
+static bool EmitBranch(Emitter& e, Offsets const& o, Instruction const& in, uint16_t next) {
+    switch (in.op) {
+        case Op::Op1nnn: {
+            uint16_t target = (in.nnn >= START_ADDRESS && in.nnn < 0xFFF) ? in.nnn : next + 2;
+            e.StoreWordImm(o.pc, target);
+            return true;
+        }
+        case Op::Op3xkk:
+        case Op::Op4xkk:
+            e.CmpByteImm(o.V(in.x), in.kk);
+            e.MovImm(Emitter::EDX, next);
+            e.MovImm(Emitter::ECX, next + 2);
+            e.CmovccEdxEcx(in.op == Op::Op3xkk ? CC_E : CC_NE);
+            e.StoreWord(o.pc, Emitter::EDX);
+            return true;
+        case Op::Op5xy0:
+        case Op::Op9xy0:
+            e.LoadByte(Emitter::EAX, o.V(in.x));
+            e.CmpByte(Emitter::EAX, o.V(in.y));
+            e.MovImm(Emitter::EDX, next);
+            e.MovImm(Emitter::ECX, next + 2);
+            e.CmovccEdxEcx(in.op == Op::Op5xy0 ? CC_E : CC_NE);
+            e.StoreWord(o.pc, Emitter::EDX);
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int32_t OffsetOf(Chip8 const& chip, void const* member) {
+    return static_cast<int32_t>(reinterpret_cast<uintptr_t>(member) - reinterpret_cast<uintptr_t>(&chip));
+}
+
+Jit::Jit() {
+#if defined(CHIP8_JIT_X64)
+#if defined(_WIN32)
+    void* mem = VirtualAlloc(nullptr, CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* mem = mmap(nullptr, CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        mem = nullptr;
+    }
+#endif
+    code = static_cast<uint8_t*>(mem);
+#endif
+    Flush();
+}
+
+Jit::~Jit() {
+#if defined(CHIP8_JIT_X64)
+    if (code) {
+#if defined(_WIN32)
+        VirtualFree(code, 0, MEM_RELEASE);
+#else
+        munmap(code, CODE_SIZE);
+#endif
+    }
+#endif
+}
+
+bool Jit::Supported() {
+#if defined(CHIP8_JIT_X64)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Jit::Flush() {
+    blocks.clear();
+    codeUsed = 0;
+    std::fill(std::begin(lookup), std::end(lookup), -1);
+}
+
+void Jit::Run(Chip8& chip, uint64_t cycles) {
+    // Compiled blocks would bypass the profiler and tracer
+    if (!code || chip.profiler || chip.tracer) {
+        chip.Run(cycles);
+        return;
+    }
+
+    // Stores made outside Step(), e.g. by chip.Run() in between, could
+    // have hit any block
+    if (owner != &chip || epoch != chip.codeEpoch || writes != chip.memoryWrites) {
+        Flush();
+        owner = &chip;
+        epoch = chip.codeEpoch;
+        writes = chip.memoryWrites;
+    }
+
+    while (cycles > 0) {
+        uint16_t pc = std::clamp(chip.hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+
+        int32_t id = lookup[pc];
+        if (id < 0) {
+            id = Compile(chip, pc);
+        }
+
+        Block const& block = blocks[id];
+        if (block.length == 0 || block.length > cycles) {
+            Step(chip);
+            --cycles;
+            continue;
+        }
+
+        chip.hot.pc = pc;
+        block.func(&chip);
+        cycles -= block.length;
+    }
+}
+
+void Jit::Step(Chip8& chip) {
+    uint16_t pc = std::clamp(chip.hot.pc, static_cast<uint16_t>(START_ADDRESS), static_cast<uint16_t>(MEMORY_SIZE - 2));
+    uint16_t opcode = (chip.memory[pc] << 8u) | chip.memory[pc + 1];
+    uint16_t index = chip.hot.index;
+
+    chip.Cycle();
+
+    uint16_t stored = Chip8::StoreLength(opcode);
+    if (stored > 0) {
+        Invalidate(index, stored);
+    }
+    writes = chip.memoryWrites;
+}
+
+// Only blocks starting less than a maximum block length before the store
+// can cover it, and only blocks still in lookup can run again
+void Jit::Invalidate(uint16_t address, uint16_t length) {
+    unsigned int end = std::min<unsigned int>(address + length, MEMORY_SIZE);
+    unsigned int reach = 2 * MAX_BLOCK_INSTRUCTIONS;
+    unsigned int first = address > reach ? address - reach : 0;
+
+    for (unsigned int start = first; start < end; ++start) {
+        int32_t id = lookup[start];
+        if (id >= 0 && address < blocks[id].end) {
+            lookup[start] = -1;
+        }
+    }
+}
+
+int32_t Jit::Compile(Chip8 const& chip, uint16_t start) {
+    if (codeUsed + MAX_BLOCK_BYTES > CODE_SIZE || blocks.size() >= MAX_BLOCKS) {
+        Flush();
+    }
+
+    Offsets o{};
+    o.registers = OffsetOf(chip, chip.hot.registers);
+    o.index = OffsetOf(chip, &chip.hot.index);
+    o.pc = OffsetOf(chip, &chip.hot.pc);
+
+    Emitter e;
+    e.Prologue();
+
+    uint16_t address = start;
+    uint32_t count = 0;
+    bool branched = false;
+
+    while (count < MAX_BLOCK_INSTRUCTIONS && address <= MEMORY_SIZE - 2) {
+        Instruction in = Chip8::Decode((chip.memory[address] << 8u) | chip.memory[address + 1]);
+        uint16_t next = address + 2;
+
+        if (EmitStraight(e, o, in)) {
+            ++count;
+            address = next;
+        } else if (EmitBranch(e, o, in, next)) {
+            ++count;
+            address = next;
+            branched = true;
+            break;
+        } else {
+            break;
+        }
+    }
+
+    Block block{start, address, count, nullptr};
+
+    if (count == 0) {
+        block.end = start + 2;
+    } else {
+        if (!branched) {
+            e.StoreWordImm(o.pc, address);
+        }
+        e.Epilogue();
+
+        uint8_t* dest = code + codeUsed;
+#if defined(CHIP8_JIT_X64)
+        // Only the one or two pages the block lands on are made writable
+        size_t pageStart = codeUsed & ~(CODE_PAGE - 1);
+        size_t pageEnd = (codeUsed + e.bytes.size() + CODE_PAGE - 1) & ~(CODE_PAGE - 1);
+        uint8_t* pages = code + pageStart;
+        size_t pagesSize = pageEnd - pageStart;
+#if defined(_WIN32)
+        DWORD old;
+        VirtualProtect(pages, pagesSize, PAGE_READWRITE, &old);
+        memcpy(dest, e.bytes.data(), e.bytes.size());
+        VirtualProtect(pages, pagesSize, PAGE_EXECUTE_READ, &old);
+        FlushInstructionCache(GetCurrentProcess(), dest, e.bytes.size());
+#else
+        mprotect(pages, pagesSize, PROT_READ | PROT_WRITE);
+        memcpy(dest, e.bytes.data(), e.bytes.size());
+        mprotect(pages, pagesSize, PROT_READ | PROT_EXEC);
+#endif
+#endif
+        codeUsed += (e.bytes.size() + 15) & ~static_cast<size_t>(15);
+        block.func = reinterpret_cast<BlockFunc>(dest);
+    }
+
+    blocks.push_back(block);
+    lookup[start] = static_cast<int32_t>(blocks.size() - 1);
+    return lookup[start];
+}
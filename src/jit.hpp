@@ -0,0 +1,48 @@
+#pragma once
+#include "chip.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Basic-block recompiler to x86-64. Straight-line ALU code is translated and
+// cached by entry PC; everything else is stepped through Chip8::Cycle().
+// Resulting state is identical to running the interpreter.
+class Jit {
+
+    public:
+        Jit();
+        ~Jit();
+        Jit(Jit const&) = delete;
+        Jit& operator=(Jit const&) = delete;
+
+        void Run(Chip8& chip, uint64_t cycles);
+
+        // Forgets every compiled block. Call after copy-assigning into a
+        // machine this Jit runs: the copy keeps the machine's address and
+        // may bring the same code epoch and write count with other code.
+        void Flush();
+
+        static bool Supported();
+
+    private:
+        typedef void (*BlockFunc)(Chip8*);
+
+        struct Block {
+            uint16_t start;
+            uint16_t end;       // one past the last byte translated
+            uint32_t length;    // instructions executed per call, 0 = interpret
+            BlockFunc func;
+        };
+
+        std::vector<Block> blocks;
+        int32_t lookup[MEMORY_SIZE];
+        uint8_t* code{};
+        size_t codeUsed{};
+        Chip8 const* owner{};
+        uint32_t epoch{};
+        uint32_t writes{};      // owner's memoryWrites already accounted for
+
+        int32_t Compile(Chip8 const& chip, uint16_t start);
+        void Invalidate(uint16_t address, uint16_t length);
+        void Step(Chip8& chip);
+};
@@ -0,0 +1,161 @@
+#include "log.hpp"
+
+static_assert((LOG_CAPACITY & (LOG_CAPACITY - 1)) == 0, "LOG_CAPACITY must be a power of two");
+
+// How long the drain thread sleeps when the ring is empty
+const std::chrono::milliseconds DRAIN_IDLE(2);
+
+struct SiteInfo {
+    char const* name;
+    Severity severity;
+    char const* format;     // printf format taking a and b
+};
+
+static const SiteInfo SITE_INFO[DIAG_COUNT] = {
+    {"invalid_opcode", Severity::Warning, "INVALID OPCODE: %x at PC=%x"},
+    {"problematic_opcode", Severity::Warning, "Detected problematic opcode pattern: %x"},
+    {"too_many_invalid_ops", Severity::Error, "TOO MANY INVALID OPS! Resetting..."},
+    {"stack_underflow", Severity::Error, "Stack underflow at 00EE! (PC=%x)"},
+    {"stack_overflow", Severity::Error, "STACK OVERFLOW! Resetting... (PC=%x)"},
+    {"sprite_out_of_bounds", Severity::Warning, "DRAW: Invalid sprite memory access (I=%x)"},
+    {"index_overflow", Severity::Warning, "Index register overflow: 0x%x"},
+    {"store_out_of_bounds", Severity::Warning, "ERROR: Memory store out of bounds (I=%x)"},
+    {"load_out_of_bounds", Severity::Warning, "ERROR: Memory load out of bounds (I=%x)"},
+};
+
+static int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+char const* DiagName(Diag diag) {
+    return SITE_INFO[static_cast<unsigned int>(diag)].name;
+}
+
+Logger& Logger::Instance() {
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() {
+    for (size_t i = 0; i < LOG_CAPACITY; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    drain = std::thread(&Logger::DrainLoop, this);
+}
+
+Logger::~Logger() {
+    stopping.store(true, std::memory_order_release);
+    drain.join();
+}
+
+void Logger::Report(Diag diag, uint16_t a, uint16_t b) {
+    if (SITE_INFO[static_cast<unsigned int>(diag)].severity < minLevel.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    Site& site = sites[static_cast<unsigned int>(diag)];
+
+    if (!Allow(site)) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (!Push(LogEntry{diag, a, b})) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// At most LOG_RATE_LIMIT messages per site in each window
+bool Logger::Allow(Site& site) {
+    int64_t now = NowMs();
+    int64_t start = site.windowStart.load(std::memory_order_relaxed);
+
+    if (now - start >= LOG_RATE_WINDOW.count()
+        && site.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        site.inWindow.store(0, std::memory_order_relaxed);
+    }
+
+    return site.inWindow.fetch_add(1, std::memory_order_relaxed) < LOG_RATE_LIMIT;
+}
+
+// Bounded multi-producer queue: a slot is free for position pos when its
+// sequence equals pos, and readable once the producer sets it to pos + 1
+bool Logger::Push(LogEntry const& entry) {
+    uint64_t pos = head.load(std::memory_order_relaxed);
+
+    while (true) {
+        Slot& slot = slots[pos & (LOG_CAPACITY - 1)];
+        uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence - pos);
+
+        if (diff == 0) {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.entry = entry;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool Logger::Pop(LogEntry& entry) {
+    uint64_t pos = tail.load(std::memory_order_relaxed);
+    Slot& slot = slots[pos & (LOG_CAPACITY - 1)];
+
+    if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+        return false;
+    }
+
+    entry = slot.entry;
+    slot.sequence.store(pos + LOG_CAPACITY, std::memory_order_release);
+    tail.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+void Logger::Write(FILE* output, LogEntry const& entry) {
+    SiteInfo const& info = SITE_INFO[static_cast<unsigned int>(entry.diag)];
+    fprintf(output, info.format, entry.a, entry.b);
+    fputc('\n', output);
+}
+
+void Logger::DrainLoop() {
+    LogEntry entry;
+
+    while (true) {
+        bool stop = stopping.load(std::memory_order_acquire);
+
+        // With output off entries are only dropped; fflush(nullptr) would
+        // flush every stream in the process
+        FILE* output = out.load(std::memory_order_relaxed);
+        bool wrote = false;
+        uint64_t done = tail.load(std::memory_order_relaxed);
+        while (Pop(entry)) {
+            if (output) {
+                Write(output, entry);
+                wrote = true;
+            }
+            ++done;
+        }
+        if (wrote) {
+            fflush(output);
+        }
+        written.store(done, std::memory_order_release);
+
+        if (stop) {
+            break;
+        }
+        std::this_thread::sleep_for(DRAIN_IDLE);
+    }
+}
+
+void Logger::Flush() {
+    uint64_t target = head.load(std::memory_order_acquire);
+    while (written.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(DRAIN_IDLE);
+    }
+}
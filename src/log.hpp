@@ -0,0 +1,105 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+enum class Severity : uint8_t {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off,
+};
+
+// Every place the core reports a problem from; each has its own counter,
+// rate limit and message format
+enum class Diag : uint8_t {
+    InvalidOpcode,
+    ProblematicOpcode,
+    TooManyInvalidOps,
+    StackUnderflow,
+    StackOverflow,
+    SpriteOutOfBounds,
+    IndexOverflow,
+    StoreOutOfBounds,
+    LoadOutOfBounds,
+};
+
+const unsigned int DIAG_COUNT = static_cast<unsigned int>(Diag::LoadOutOfBounds) + 1;
+
+char const* DiagName(Diag diag);
+
+const size_t LOG_CAPACITY = 4096;                     // entries, power of two
+const unsigned int LOG_RATE_LIMIT = 10;               // messages per site per window
+const std::chrono::milliseconds LOG_RATE_WINDOW(1000);
+
+// Raw values a message is formatted from later, on the logging thread
+struct LogEntry {
+    Diag diag;
+    uint16_t a;
+    uint16_t b;
+};
+
+// Process-wide diagnostic log. Report() never formats or blocks: it applies
+// the site's rate limit and pushes a small entry into a lock-free ring,
+// which a background thread formats and writes out. Entries that find the
+// ring full are counted and dropped. Occurrences are counted by the caller
+// (see Chip8::Diagnostics), so machines running on different threads do
+// not share a counter; below the level nothing shared is written at all.
+class Logger {
+
+    public:
+        static Logger& Instance();
+
+        ~Logger();
+        Logger(Logger const&) = delete;
+        Logger& operator=(Logger const&) = delete;
+
+        void Report(Diag diag, uint16_t a = 0, uint16_t b = 0);
+
+        // Messages below this level are skipped
+        void SetLevel(Severity level) { minLevel.store(level, std::memory_order_relaxed); }
+        void SetOutput(FILE* output) { out.store(output, std::memory_order_relaxed); }
+
+        uint64_t Suppressed(Diag diag) const { return sites[static_cast<unsigned int>(diag)].suppressed.load(std::memory_order_relaxed); }
+        uint64_t Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+        // Blocks until everything reported so far has been written
+        void Flush();
+
+    private:
+        Logger();
+
+        struct Slot {
+            std::atomic<uint64_t> sequence;
+            LogEntry entry;
+        };
+
+        struct Site {
+            std::atomic<uint64_t> suppressed{};
+            std::atomic<int64_t> windowStart{};
+            std::atomic<uint32_t> inWindow{};
+        };
+
+        Slot slots[LOG_CAPACITY];
+        std::atomic<uint64_t> head{};     // next slot producers claim
+        std::atomic<uint64_t> tail{};     // next slot the drain thread reads
+        std::atomic<uint64_t> written{};  // entries before this are out and flushed
+        std::atomic<uint64_t> dropped{};
+
+        Site sites[DIAG_COUNT];
+        std::atomic<Severity> minLevel{Severity::Info};
+        std::atomic<FILE*> out{stderr};
+
+        std::atomic<bool> stopping{false};
+        std::thread drain;
+
+        bool Allow(Site& site);
+        bool Push(LogEntry const& entry);
+        bool Pop(LogEntry& entry);
+        void Write(FILE* output, LogEntry const& entry);
+        void DrainLoop();
+};
@@ -0,0 +1,152 @@
+#include "lz.hpp"
+#include <cstring>
+
+const unsigned int HASH_BITS = 12;
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 0xFFFF;
+
+static uint32_t Read32(uint8_t const* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t Hash(uint32_t value) {
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 or more continue in extra bytes of up to 255 each
+static void PutLength(uint8_t*& out, size_t length) {
+    while (length >= 255) {
+        *out++ = 255;
+        length -= 255;
+    }
+    *out++ = static_cast<uint8_t>(length);
+}
+
+size_t LzBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+size_t LzCompress(uint8_t const* src, size_t size, uint8_t* dst) {
+    uint32_t table[1u << HASH_BITS] = {};   // position + 1, 0 = empty
+    uint8_t* out = dst;
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while (size >= MIN_MATCH && pos <= size - MIN_MATCH) {
+        uint32_t value = Read32(src + pos);
+        uint32_t h = Hash(value);
+        size_t candidate = table[h];
+        table[h] = static_cast<uint32_t>(pos + 1);
+
+        if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || Read32(src + candidate - 1) != value) {
+            ++pos;
+            continue;
+        }
+
+        size_t match = candidate - 1;
+        size_t length = MIN_MATCH;
+        while (pos + length < size && src[match + length] == src[pos + length]) {
+            ++length;
+        }
+
+        size_t literals = pos - anchor;
+        size_t extra = length - MIN_MATCH;
+        uint8_t* token = out++;
+        *token = static_cast<uint8_t>(((literals < 15 ? literals : 15) << 4) | (extra < 15 ? extra : 15));
+
+        if (literals >= 15) {
+            PutLength(out, literals - 15);
+        }
+        memcpy(out, src + anchor, literals);
+        out += literals;
+
+        size_t offset = pos - match;
+        *out++ = static_cast<uint8_t>(offset);
+        *out++ = static_cast<uint8_t>(offset >> 8);
+
+        if (extra >= 15) {
+            PutLength(out, extra - 15);
+        }
+
+        pos += length;
+        anchor = pos;
+    }
+
+    // Trailing literals, with an empty match marked by offset 0
+    size_t literals = size - anchor;
+    *out++ = static_cast<uint8_t>((literals < 15 ? literals : 15) << 4);
+    if (literals >= 15) {
+        PutLength(out, literals - 15);
+    }
+    if (literals > 0) {
+        memcpy(out, src + anchor, literals);
+        out += literals;
+    }
+    *out++ = 0;
+    *out++ = 0;
+
+    return static_cast<size_t>(out - dst);
+}
+
+static bool GetLength(uint8_t const*& in, uint8_t const* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (in >= end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool LzDecompress(uint8_t const* src, size_t size, uint8_t* dst, size_t rawSize) {
+    uint8_t const* in = src;
+    uint8_t const* end = src + size;
+    size_t pos = 0;
+
+    while (in < end) {
+        uint8_t token = *in++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !GetLength(in, end, literals)) {
+            return false;
+        }
+        if (literals > static_cast<size_t>(end - in) || literals > rawSize - pos) {
+            return false;
+        }
+        memcpy(dst + pos, in, literals);
+        in += literals;
+        pos += literals;
+
+        if (end - in < 2) {
+            return false;
+        }
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+
+        if (offset == 0) {
+            return in == end && pos == rawSize;
+        }
+
+        size_t length = token & 0x0F;
+        if (length == 15 && !GetLength(in, end, length)) {
+            return false;
+        }
+        length += MIN_MATCH;
+
+        if (offset > pos || length > rawSize - pos) {
+            return false;
+        }
+
+        // Byte by byte, since a match may overlap its own output
+        for (size_t i = 0; i < length; ++i) {
+            dst[pos + i] = dst[pos - offset + i];
+        }
+        pos += length;
+    }
+
+    return false;
+}
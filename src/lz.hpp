@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Small byte-oriented LZ77 codec in the style of LZ4: a token byte holds
+// a literal count and a match length, followed by the literals and a
+// 16-bit match offset. Fast enough to run on every trace chunk.
+
+// Worst-case output size for size input bytes
+size_t LzBound(size_t size);
+
+// Returns the compressed size; dst must hold LzBound(size) bytes
+size_t LzCompress(uint8_t const* src, size_t size, uint8_t* dst);
+
+// Returns false if src is malformed or does not decode to exactly rawSize bytes
+bool LzDecompress(uint8_t const* src, size_t size, uint8_t* dst, size_t rawSize);
@@ -1,53 +1,374 @@
 #define SDL_MAIN_HANDLED
 #undef main
+#include "audio.hpp"
 #include "chip.hpp"
+#include "input.hpp"
+#include "input_log.hpp"
 #include "platform.hpp"
+#include "rewind.hpp"
+#include "scheduler.hpp"
+#include "triple_buffer.hpp"
+#include "video.hpp"
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <algorithm>  
+#include <string>
+#include <thread>
+
+// Batch size used for a <Delay> of 0
+const unsigned int UNCAPPED_CYCLES_PER_FRAME = 1000;
+
+// How long the render thread idles when no new frame has been published
+const std::chrono::milliseconds RENDER_IDLE(1);
+
+// Fast-forward runs this many emulated frames per displayed frame; '='
+// and '-' double and halve it, and past the maximum it runs uncapped
+const unsigned int DEFAULT_TURBO_SPEED = 4;
+const unsigned int MAX_TURBO_SPEED = 64;
+const unsigned int TURBO_UNCAPPED = 0;
+
+// Emulation time per displayed frame when uncapped, leaving the rest of
+// the 16.7 ms for publishing and the scheduler's wake-up
+const std::chrono::microseconds UNCAPPED_FRAME_BUDGET(12500);
+
+// How often the window title's speed readout is refreshed
+const std::chrono::milliseconds SPEED_UPDATE_INTERVAL(500);
+
+const char* const WINDOW_TITLE = "CHIP-8 Emulator";
+
+// Completed framebuffer handed from the emulation thread to the renderer
+struct VideoFrame {
+    uint64_t video[VIDEO_HEIGHT];
+    uint64_t inputTime;     // earliest key press in it that was not presented yet, 0 = none
+};
 
 int main(int argc, char** argv) {
-    if (argc != 4) {
-        std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM>\n";
+    if (argc < 4 || argc % 2 == 1) {
+        std::cerr << "Usage: " << argv[0] << " <Scale> <Delay> <ROM> [--seed N] [--record Log] [--turbo N|max] [--audio-buffer N] [--keymap File] [--latency on|off]\n";
         std::exit(EXIT_FAILURE);
     }
 
     int videoScale = std::stoi(argv[1]);
     int cycleDelay = std::stoi(argv[2]);
     char const* romFilename = argv[3];
+    uint64_t seed = std::chrono::system_clock::now().time_since_epoch().count();
+    char const* recordFilename = nullptr;
+    unsigned int turboSpeed = DEFAULT_TURBO_SPEED;
+    unsigned int audioBuffer = DEFAULT_AUDIO_BUFFER;
+    char const* keyMapFilename = nullptr;
+    bool measureLatency = false;
+
+    for (int i = 4; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+
+        if (option == "--seed") {
+            seed = std::stoull(argv[i + 1]);
+        } else if (option == "--record") {
+            recordFilename = argv[i + 1];
+        } else if (option == "--audio-buffer") {
+            audioBuffer = std::clamp(std::stoi(argv[i + 1]), 64, 8192);
+        } else if (option == "--keymap") {
+            keyMapFilename = argv[i + 1];
+        } else if (option == "--latency") {
+            measureLatency = std::string(argv[i + 1]) == "on";
+        } else if (option == "--turbo") {
+            std::string value = argv[i + 1];
+            turboSpeed = value == "max" ? TURBO_UNCAPPED : std::clamp(std::stoi(value), 2, static_cast<int>(MAX_TURBO_SPEED));
+        } else {
+            std::cerr << "Unknown option: " << option << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    // <Delay> keeps its meaning of milliseconds per instruction, but the
+    // instructions now run in one batch per 60 Hz frame
+    unsigned int cyclesPerFrame = UNCAPPED_CYCLES_PER_FRAME;
+    if (cycleDelay > 0) {
+        cyclesPerFrame = std::max(1L, std::lround(1000.0 / (FRAME_RATE * cycleDelay)));
+    }
+
+    // Declared first so the audio callback can never outlive it
+    Buzzer buzzer;
+    Platform platform(WINDOW_TITLE, VIDEO_WIDTH * videoScale, VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
 
-    Platform platform("CHIP-8 Emulator", VIDEO_WIDTH * videoScale, VIDEO_HEIGHT * videoScale, VIDEO_WIDTH, VIDEO_HEIGHT);
+    bool audio = platform.OpenAudio(buzzer, audioBuffer);
+
+    if (keyMapFilename) {
+        KeyMap keyMap;
+        if (!keyMap.Load(keyMapFilename)) {
+            std::exit(EXIT_FAILURE);
+        }
+        platform.SetKeyMap(keyMap);
+    }
 
     Chip8 chip8;
     memset(chip8.video, 0, sizeof(chip8.video));
     chip8.drawFlag = true;
     chip8.LoadROM(romFilename);
+    chip8.Seed(seed);
+
+    // Recorded events carry the instruction each key change was delivered at
+    InputLog log;
+    log.seed = seed;
+    log.cyclesPerFrame = cyclesPerFrame;
     static uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
     int videoPitch = sizeof(uint32_t) * VIDEO_WIDTH;
-    auto lastCycleTime = std::chrono::high_resolution_clock::now();
+
+    // The core runs on its own thread so a present blocked on vsync never
+    // holds up emulation. Frames go out through a triple buffer, keys come
+    // back as timestamped events.
+    TripleBuffer<VideoFrame> frames;
+    KeyEventQueue keyEvents;
+    std::atomic<bool> rewind{false};
+    std::atomic<bool> running{true};
+    std::atomic<unsigned int> speed{1};              // emulated frames per displayed frame, 0 = uncapped
+    std::atomic<uint64_t> emulatedFrames{0};
+    FrameStats stats{};
+
+    // With --latency on, each key press is timed until the instruction
+    // batch it lands in runs, and until the first present after that
+    LatencyRecorder coreLatency;
+    LatencyRecorder presentLatency;
+    std::atomic<uint64_t> presentedInput{0};         // inputTime of the last frame presented
+
+    std::thread emulation([&] {
+        FrameScheduler scheduler;
+        RewindBuffer history;
+        uint64_t audioFrame = 0;
+        uint16_t heldKeys = 0;
+        uint64_t pendingInput = 0;
+
+        // Key events polled since the previous frame, each with the
+        // instruction of this frame's batch it is delivered at
+        struct TimedKeys {
+            KeyEvent event;
+            uint64_t instruction;
+        };
+        TimedKeys timeline[KEY_EVENT_QUEUE_SIZE];
+        uint64_t lastCollect = InputClock();
+
+        while (running.load(std::memory_order_relaxed)) {
+            // Events are spread over the batch in proportion to when they
+            // were polled within the last frame interval, so a tap shorter
+            // than a frame is still seen and presses keep their spacing.
+            // The batch runs in one burst, so this adds no wall-clock delay.
+            // Uncapped fast-forward maps the interval onto its first frame.
+            unsigned int frameCount = speed.load(std::memory_order_relaxed);
+            uint64_t span = uint64_t(std::max(1u, frameCount)) * cyclesPerFrame;
+            uint64_t now = InputClock();
+            size_t eventCount = 0;
+            size_t nextEvent = 0;
+
+            KeyEvent event;
+            while (eventCount < KEY_EVENT_QUEUE_SIZE && keyEvents.Pop(event)) {
+                uint64_t at = event.time > lastCollect && now > lastCollect
+                            ? (event.time - lastCollect) * span / (now - lastCollect) : 0;
+                timeline[eventCount++] = {event, std::min(at, span - 1)};
+            }
+            lastCollect = now;
+
+            if (pendingInput != 0 && presentedInput.load(std::memory_order_acquire) >= pendingInput) {
+                pendingInput = 0;
+            }
+
+            auto applyKeys = [&](KeyEvent const& keyEvent) {
+                if (measureLatency && (keyEvent.keys & ~heldKeys)) {
+                    coreLatency.Add(InputClockMs(InputClock() - keyEvent.time));
+                    if (pendingInput == 0) {
+                        pendingInput = keyEvent.time;
+                    }
+                }
+                heldKeys = keyEvent.keys;
+                chip8.SetKeys(heldKeys);
+            };
+
+            // Holding rewind steps back one recorded frame per frame. A
+            // recording cannot express going back, so it disables rewind.
+            if (rewind.load(std::memory_order_relaxed) && !recordFilename) {
+                for (; nextEvent < eventCount; ++nextEvent) {
+                    heldKeys = timeline[nextEvent].event.keys;
+                }
+                history.Rewind(chip8, 1);
+                buzzer.Update(audioFrame++, false);
+            } else {
+                // Fast-forward runs several frames per displayed frame, or
+                // as many as fit in the frame budget when uncapped. Only
+                // the last of them is published, so the frames in between
+                // are never converted or uploaded, and the buzzer is muted.
+                auto runFrame = [&](uint64_t first) {
+                    uint32_t done = 0;
+                    chip8.SetKeys(heldKeys);
+
+                    for (; nextEvent < eventCount && timeline[nextEvent].instruction < first + cyclesPerFrame; ++nextEvent) {
+                        uint32_t at = static_cast<uint32_t>(std::max(timeline[nextEvent].instruction, first) - first);
+                        if (at > done) {
+                            chip8.Run(at - done);
+                            done = at;
+                        }
+                        applyKeys(timeline[nextEvent].event);
+                        log.Record(log.frames, at, heldKeys);
+                    }
+
+                    chip8.Run(cyclesPerFrame - done);
+                    chip8.TickTimers();
+                    buzzer.Update(audioFrame++, frameCount == 1 && chip8.Buzzing());
+                    history.Push(chip8);
+                    ++log.frames;
+                    emulatedFrames.fetch_add(1, std::memory_order_relaxed);
+                };
+
+                if (frameCount == TURBO_UNCAPPED) {
+                    auto end = std::chrono::steady_clock::now() + UNCAPPED_FRAME_BUDGET;
+                    uint64_t first = 0;
+                    do {
+                        runFrame(first);
+                        first += cyclesPerFrame;
+                    } while (std::chrono::steady_clock::now() < end);
+                } else {
+                    for (unsigned int n = 0; n < frameCount; ++n) {
+                        runFrame(uint64_t(n) * cyclesPerFrame);
+                    }
+                }
+            }
+
+            if (chip8.dirtyRows) {
+                VideoFrame& frame = frames.Back();
+                std::copy(std::begin(chip8.video), std::end(chip8.video), frame.video);
+                frame.inputTime = pendingInput;
+                frames.Publish();
+                chip8.dirtyRows = 0;
+                chip8.drawFlag = false;
+            }
+
+            scheduler.WaitForNextFrame();
+        }
+
+        stats = scheduler.Stats();
+    });
+
+    // Frames may be skipped, so dirty rows are found by comparing against
+    // what was last uploaded rather than taken from the core
+    uint64_t shown[VIDEO_HEIGHT]{};
+    uint32_t forceRows = ~0u;
+    uint16_t keyMask = 0;
+    uint64_t waitingInput = 0;
+    uint64_t lastPresentedInput = 0;
+    bool rewinding = false;
+    bool turbo = false;
+    bool showingSpeed = false;
+    int speedSteps = 0;
     bool quit = false;
 
+    auto speedCheck = std::chrono::steady_clock::now();
+    uint64_t speedCheckFrames = 0;
+
     while (!quit) {
-        quit = platform.ProcessInput(chip8.keypad);
-        
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float dt = std::chrono::duration<float, std::chrono::milliseconds::period>(currentTime - lastCycleTime).count();
-    
-        if (dt > cycleDelay) {
-            lastCycleTime = currentTime;
-            chip8.Cycle();
-            
-            if (chip8.drawFlag) {
-                for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++) {
-                    // 0xFF000000 = Black (Alpha=255, R=0, G=0, B=0)
-                    // 0xFFFFFFFF = White (Alpha=255, R=255, G=255, B=255)
-                    pixels[i] = chip8.video[i] ? 0xFFFFFFFF : 0xFF000000;
-                }
-                
-                platform.Update(pixels, videoPitch);
-                chip8.drawFlag = false;  
+        quit = platform.ProcessInput(keyMask, keyEvents, rewinding, turbo, speedSteps);
+        rewind.store(rewinding, std::memory_order_relaxed);
+
+        for (; speedSteps > 0; --speedSteps) {
+            turboSpeed = turboSpeed == TURBO_UNCAPPED ? TURBO_UNCAPPED
+                       : turboSpeed * 2 > MAX_TURBO_SPEED ? TURBO_UNCAPPED : turboSpeed * 2;
+        }
+        for (; speedSteps < 0; ++speedSteps) {
+            turboSpeed = turboSpeed == TURBO_UNCAPPED ? MAX_TURBO_SPEED : std::max(2u, turboSpeed / 2);
+        }
+        speed.store(turbo ? turboSpeed : 1, std::memory_order_relaxed);
+
+        // Achieved speed relative to 60 frames per second, while fast-forwarding
+        auto now = std::chrono::steady_clock::now();
+        if (now - speedCheck >= SPEED_UPDATE_INTERVAL) {
+            uint64_t emulated = emulatedFrames.load(std::memory_order_relaxed);
+            double seconds = std::chrono::duration<double>(now - speedCheck).count();
+            double multiplier = (emulated - speedCheckFrames) / (seconds * FRAME_RATE);
+
+            if (turbo) {
+                std::string target = turboSpeed == TURBO_UNCAPPED ? "max" : std::to_string(turboSpeed) + "x";
+                char title[128];
+                snprintf(title, sizeof(title), "%s - fast forward %s (%.1fx)", WINDOW_TITLE, target.c_str(), multiplier);
+                platform.SetTitle(title);
+                showingSpeed = true;
+            } else if (showingSpeed) {
+                platform.SetTitle(WINDOW_TITLE);
+                showingSpeed = false;
             }
+
+            speedCheck = now;
+            speedCheckFrames = emulated;
+        }
+
+        if (!frames.Acquire()) {
+            std::this_thread::sleep_for(RENDER_IDLE);
+            continue;
         }
+
+        VideoFrame const& frame = frames.Front();
+        uint32_t dirtyRows = forceRows;
+        for (unsigned int row = 0; row < VIDEO_HEIGHT; ++row) {
+            if (frame.video[row] != shown[row]) {
+                dirtyRows |= 1u << row;
+                shown[row] = frame.video[row];
+            }
+        }
+        forceRows = 0;
+
+        // A press whose frame draws nothing is timed to the next present
+        if (frame.inputTime > lastPresentedInput) {
+            waitingInput = frame.inputTime;
+        }
+
+        if (dirtyRows) {
+            // 0xFF000000 = Black (Alpha=255, R=0, G=0, B=0)
+            // 0xFFFFFFFF = White (Alpha=255, R=255, G=255, B=255)
+            ForEachRowSpan(dirtyRows, [&](unsigned int firstRow, unsigned int rowCount) {
+                ExpandRows(frame.video, pixels, firstRow, rowCount, 0xFFFFFFFF, 0xFF000000);
+                platform.UploadRows(pixels + firstRow * VIDEO_WIDTH, videoPitch, firstRow, rowCount);
+            });
+
+            platform.Present();
+
+            if (waitingInput != 0) {
+                presentLatency.Add(InputClockMs(InputClock() - waitingInput));
+                presentedInput.store(waitingInput, std::memory_order_release);
+                lastPresentedInput = waitingInput;
+                waitingInput = 0;
+            }
+        }
+    }
+
+    running.store(false, std::memory_order_relaxed);
+    emulation.join();
+    platform.CloseAudio();
+
+    if (recordFilename && log.Save(recordFilename)) {
+        std::cout << "Recorded " << log.frames << " frames, " << log.events.size() << " input events\n";
+    }
+
+    std::cout << "Frames: " << stats.frames
+              << ", mean frame time: " << stats.meanFrameMs << " ms"
+              << ", jitter: " << stats.jitterMs << " ms"
+              << ", max late: " << stats.maxLateMs << " ms\n";
+
+    if (measureLatency) {
+        LatencyStats toCore = coreLatency.Stats();
+        LatencyStats toPresent = presentLatency.Stats();
+        std::cout << "Input latency over " << toCore.count << " key presses"
+                  << ": to core mean " << toCore.meanMs << " ms, max " << toCore.maxMs << " ms"
+                  << "; to present mean " << toPresent.meanMs << " ms"
+                  << ", p50 " << toPresent.p50Ms << " ms"
+                  << ", p99 " << toPresent.p99Ms << " ms"
+                  << ", max " << toPresent.maxMs << " ms (" << toPresent.count << " presents)\n";
+    }
+
+    if (audio) {
+        AudioStats audioStats = buzzer.Stats();
+        std::cout << "Audio latency: mean " << audioStats.meanLatencyMs << " ms"
+                  << ", max " << audioStats.maxLatencyMs << " ms"
+                  << " over " << audioStats.transitions << " transitions"
+                  << ", late: " << audioStats.late << ", dropped: " << audioStats.dropped << "\n";
     }
     
     return 0;   
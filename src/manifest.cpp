@@ -0,0 +1,70 @@
+#include "manifest.hpp"
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+bool ParseManifest(char const* filename, std::vector<ManifestJob>& jobs) {
+    std::ifstream file(filename);
+    if (!file) {
+        std::cerr << "ERROR: Failed to open manifest " << filename << "\n";
+        return false;
+    }
+
+    std::string line;
+    unsigned int lineNumber = 0;
+
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        std::istringstream fields(line);
+        std::string rom, seed, frames, log;
+
+        if (!(fields >> rom) || rom[0] == '#') {
+            continue;
+        }
+
+        fields >> seed >> frames >> log;
+        bool needsLog = seed == "-" || frames == "-";
+
+        if (frames.empty() || (needsLog && log.empty())) {
+            std::cerr << "ERROR: " << filename << ":" << lineNumber << ": expected <ROM> <Seed|-> <Frames|-> [InputLog]\n";
+            return false;
+        }
+
+        ManifestJob job{jobs.size(), rom, log, 0, 0, seed == "-", frames == "-"};
+        try {
+            job.seed = job.seedFromLog ? 0 : std::stoull(seed);
+            job.frames = job.framesFromLog ? 0 : std::stoull(frames);
+        } catch (std::exception const&) {
+            std::cerr << "ERROR: " << filename << ":" << lineNumber << ": invalid number\n";
+            return false;
+        }
+        jobs.push_back(job);
+    }
+
+    return true;
+}
+
+static bool ReadFile(std::string const& filename, std::vector<uint8_t>& bytes) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "ERROR: Failed to open ROM file " << filename << "\n";
+        return false;
+    }
+
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool ManifestFiles::Load(std::vector<ManifestJob> const& jobs) {
+    for (ManifestJob const& job : jobs) {
+        if (!roms.count(job.rom) && !ReadFile(job.rom, roms[job.rom])) {
+            return false;
+        }
+        if (!job.log.empty() && !logs.count(job.log) && !logs[job.log].Load(job.log.c_str())) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "input_log.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// One line of a job manifest, as read by chip8-fleet and chip8-golden:
+//
+//   <ROM> <Seed|-> <Frames|-> [InputLog]
+//
+// '-' takes the seed or session length from the input log; lines starting
+// with '#' are ignored.
+struct ManifestJob {
+    size_t id;
+    std::string rom;
+    std::string log;
+    uint64_t seed;
+    uint64_t frames;
+    bool seedFromLog;
+    bool framesFromLog;
+};
+
+bool ParseManifest(char const* filename, std::vector<ManifestJob>& jobs);
+
+// Every ROM and input log the jobs name, each read once however many
+// jobs share it
+struct ManifestFiles {
+    std::map<std::string, std::vector<uint8_t>> roms;
+    std::map<std::string, InputLog> logs;
+
+    bool Load(std::vector<ManifestJob> const& jobs);
+};
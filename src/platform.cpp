@@ -1,9 +1,12 @@
 #include "platform.hpp"
+#include "audio.hpp"
 #include <SDL.h>
 #include <cstring>
 #include <iostream>
 
-Platform::Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight) {
+Platform::Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight)
+    : textureWidth(textureWidth)
+{
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         std::cerr << "SDL initialization failed: " << SDL_GetError() << std::endl;
         exit(1);
@@ -41,6 +44,7 @@ Platform::Platform(char const* title, int windowWidth, int windowHeight, int tex
 }
 
 Platform::~Platform() {
+    CloseAudio();
     if (texture) SDL_DestroyTexture(texture);
     if (renderer) SDL_DestroyRenderer(renderer);
     if (window) SDL_DestroyWindow(window);
@@ -58,72 +62,139 @@ void Platform::Update(void const* buffer, int pitch) {
         return;
     }
     
+    Present();
+}
+
+// Uploads only a horizontal band of the texture; rows points at firstRow
+void Platform::UploadRows(void const* rows, int pitch, int firstRow, int rowCount) {
+    if (!rows || !texture) {
+        std::cerr << "Invalid state in UploadRows" << std::endl;
+        return;
+    }
+
+    SDL_Rect rect{0, firstRow, textureWidth, rowCount};
+    if (SDL_UpdateTexture(texture, &rect, rows, pitch) != 0) {
+        std::cerr << "Failed to update texture: " << SDL_GetError() << std::endl;
+    }
+}
+
+void Platform::Present() {
+    if (!texture || !renderer) {
+        std::cerr << "Invalid state in Present" << std::endl;
+        return;
+    }
+
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
     SDL_RenderCopy(renderer, texture, nullptr, nullptr);
     SDL_RenderPresent(renderer);
 }
 
-bool Platform::ProcessInput(uint8_t* keys) {
+void Platform::SetTitle(char const* title) {
+    SDL_SetWindowTitle(window, title);
+}
+
+bool Platform::OpenAudio(Buzzer& newBuzzer, unsigned int bufferSamples) {
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+        std::cerr << "WARNING: Audio initialization failed: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    SDL_AudioSpec wanted{};
+    wanted.freq = static_cast<int>(newBuzzer.SampleRate());
+    wanted.format = AUDIO_S16SYS;
+    wanted.channels = 1;
+    wanted.samples = static_cast<Uint16>(bufferSamples);
+    wanted.callback = &Platform::AudioCallback;
+    wanted.userdata = this;
+
+    // No changes allowed, so SDL converts if the device's format differs
+    SDL_AudioSpec obtained{};
+    audioDevice = SDL_OpenAudioDevice(nullptr, 0, &wanted, &obtained, 0);
+    if (audioDevice == 0) {
+        std::cerr << "WARNING: Failed to open audio device: " << SDL_GetError() << std::endl;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+
+    buzzer = &newBuzzer;
+    audioDelayMs = 1000.0 * obtained.samples / obtained.freq;
+    SDL_PauseAudioDevice(audioDevice, 0);
+    return true;
+}
+
+void Platform::CloseAudio() {
+    if (audioDevice == 0) {
+        return;
+    }
+
+    SDL_CloseAudioDevice(audioDevice);
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+    audioDevice = 0;
+    buzzer = nullptr;
+}
+
+// Runs on SDL's audio thread
+void Platform::AudioCallback(void* userdata, Uint8* stream, int len) {
+    Platform* platform = static_cast<Platform*>(userdata);
+    platform->buzzer->Render(reinterpret_cast<int16_t*>(stream), len / sizeof(int16_t), platform->audioDelayMs);
+}
+
+bool Platform::ProcessInput(uint16_t& keys, KeyEventQueue& events, bool& rewinding, bool& turbo, int& speedSteps) {
     bool quit = false;
     SDL_Event event;
 
     while (SDL_PollEvent(&event)) {
+        uint16_t previous = keys;
+
         switch (event.type) {
             case SDL_QUIT: {
                 quit = true;
             } break;
 
             case SDL_KEYDOWN: {
-                switch (event.key.keysym.sym) {
-                    case SDLK_ESCAPE: {
-                        quit = true;
-                    } break;
-
-                    case SDLK_x: {
-                        keys[0] = 1;
-                    } break;
-
-                    case SDLK_1: { keys[1] = 1; } break;
-                    case SDLK_2: { keys[2] = 1; } break;
-                    case SDLK_3: { keys[3] = 1; } break;
-                    case SDLK_q: { keys[4] = 1; } break;
-                    case SDLK_w: { keys[5] = 1; } break;
-                    case SDLK_e: { keys[6] = 1; } break;
-                    case SDLK_a: { keys[7] = 1; } break;
-                    case SDLK_s: { keys[8] = 1; } break;
-                    case SDLK_d: { keys[9] = 1; } break;
-                    case SDLK_z: { keys[0xA] = 1; } break;
-                    case SDLK_c: { keys[0xB] = 1; } break;
-                    case SDLK_4: { keys[0xC] = 1; } break;
-                    case SDLK_r: { keys[0xD] = 1; } break;
-                    case SDLK_f: { keys[0xE] = 1; } break;
-                    case SDLK_v: { keys[0xF] = 1; } break;
+                if (event.key.keysym.sym == SDLK_ESCAPE) {
+                    quit = true;
+                } else if (event.key.keysym.sym == SDLK_BACKSPACE) {
+                    rewinding = true;
+                } else if (event.key.keysym.sym == SDLK_TAB && !event.key.repeat) {
+                    turbo = !turbo;
+                } else if (event.key.keysym.sym == SDLK_EQUALS) {
+                    ++speedSteps;
+                } else if (event.key.keysym.sym == SDLK_MINUS) {
+                    --speedSteps;
+                }
+
+                int key = keyMap.Find(event.key.keysym.sym);
+                if (key >= 0) {
+                    keys |= 1u << key;
                 }
             } break;
 
             case SDL_KEYUP: {
-                switch (event.key.keysym.sym) {
-                    case SDLK_x: { keys[0] = 0; } break;
-                    case SDLK_1: { keys[1] = 0; } break;
-                    case SDLK_2: { keys[2] = 0; } break;
-                    case SDLK_3: { keys[3] = 0; } break;
-                    case SDLK_q: { keys[4] = 0; } break;
-                    case SDLK_w: { keys[5] = 0; } break;
-                    case SDLK_e: { keys[6] = 0; } break;
-                    case SDLK_a: { keys[7] = 0; } break;
-                    case SDLK_s: { keys[8] = 0; } break;
-                    case SDLK_d: { keys[9] = 0; } break;
-                    case SDLK_z: { keys[0xA] = 0; } break;
-                    case SDLK_c: { keys[0xB] = 0; } break;
-                    case SDLK_4: { keys[0xC] = 0; } break;
-                    case SDLK_r: { keys[0xD] = 0; } break;
-                    case SDLK_f: { keys[0xE] = 0; } break;
-                    case SDLK_v: { keys[0xF] = 0; } break;
+                if (event.key.keysym.sym == SDLK_BACKSPACE) {
+                    rewinding = false;
+                }
+
+                int key = keyMap.Find(event.key.keysym.sym);
+                if (key >= 0) {
+                    keys &= ~(1u << key);
                 }
             } break;
         }
+
+        // SDL's own event timestamps are whole milliseconds, so the
+        // counter is read here instead
+        if (keys != previous) {
+            unsentKeys = !events.Push({InputClock(), keys});
+        }
+    }
+
+    // A full queue means the emulation thread has stalled. Rather than
+    // block, the latest keypad is resent on a later call so no key sticks.
+    if (unsentKeys) {
+        unsentKeys = !events.Push({InputClock(), keys});
     }
 
     return quit;
-}
\ No newline at end of file
+}
@@ -1,16 +1,41 @@
 #pragma once
+#include "input.hpp"
 #include <SDL2/SDL.h>
 #include <cstdint>
 
+class Buzzer;
+
 class Platform {
 public:
     Platform(char const* title, int windowWidth, int windowHeight, int textureWidth, int textureHeight);
     ~Platform();
     void Update(void const* buffer, int pitch);
-    bool ProcessInput(uint8_t* keys);
+    void UploadRows(void const* rows, int pitch, int firstRow, int rowCount);
+    void Present();
+    void SetTitle(char const* title);
+
+    // Plays buzzer on the default device with buffers of bufferSamples;
+    // false (and silence) if no device could be opened
+    bool OpenAudio(Buzzer& buzzer, unsigned int bufferSamples);
+    void CloseAudio();
+
+    void SetKeyMap(KeyMap const& newKeyMap) { keyMap = newKeyMap; }
+
+    // keys: bit n = CHIP-8 key n held; every change is also pushed to
+    // events with the time it was polled. turbo flips on each Tab press;
+    // speedSteps counts '=' presses up and '-' presses down.
+    bool ProcessInput(uint16_t& keys, KeyEventQueue& events, bool& rewinding, bool& turbo, int& speedSteps);
 
 private:
     SDL_Window* window{};
     SDL_Renderer* renderer{};
     SDL_Texture* texture{};
+    int textureWidth{};
+    KeyMap keyMap;
+    bool unsentKeys{};
+    SDL_AudioDeviceID audioDevice{};
+    Buzzer* buzzer{};
+    double audioDelayMs{};
+
+    static void AudioCallback(void* userdata, Uint8* stream, int len);
 };
\ No newline at end of file
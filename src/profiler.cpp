@@ -0,0 +1,151 @@
+#include "profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static char const* const FAMILY_NAMES[16] = {
+    "00E0/00EE", "1nnn", "2nnn", "3xkk", "4xkk", "5xy0", "6xkk", "7xkk",
+    "8xyN", "9xy0", "Annn", "Bnnn", "Cxkk", "Dxyn", "ExNN", "FxNN",
+};
+
+static std::string Hex(unsigned int value) {
+    char buffer[8];
+    snprintf(buffer, sizeof(buffer), "0x%03X", value);
+    return buffer;
+}
+
+// Addresses with the largest counts, most frequent first
+static std::vector<uint16_t> Top(uint64_t const* counts, size_t top) {
+    std::vector<uint16_t> addresses;
+    for (unsigned int address = 0; address < MEMORY_SIZE; ++address) {
+        if (counts[address] > 0) {
+            addresses.push_back(static_cast<uint16_t>(address));
+        }
+    }
+
+    size_t keep = std::min(top, addresses.size());
+    std::partial_sort(addresses.begin(), addresses.begin() + keep, addresses.end(), [&](uint16_t a, uint16_t b) {
+        return counts[a] > counts[b];
+    });
+    addresses.resize(keep);
+    return addresses;
+}
+
+Profiler::Profiler(unsigned int sampleInterval)
+    : sampleInterval(sampleInterval),
+      countdown(sampleInterval)
+{
+    // Cost of the two clock reads around a timed instruction
+    double best = 1e300;
+    for (int i = 0; i < 1000; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        auto end = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    clockOverheadNs = best;
+}
+
+void Profiler::Clear() {
+    countdown = sampleInterval;
+    instructions = 0;
+    nextPc = 0;
+    std::fill(std::begin(opCounts), std::end(opCounts), 0);
+    std::fill(std::begin(pcCounts), std::end(pcCounts), 0);
+    std::fill(std::begin(blockCounts), std::end(blockCounts), 0);
+    std::fill(std::begin(familyNs), std::end(familyNs), 0.0);
+    std::fill(std::begin(familySamples), std::end(familySamples), 0);
+    stacks.clear();
+}
+
+void Profiler::AddTime(uint16_t opcode, std::chrono::steady_clock::duration elapsed) {
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() - clockOverheadNs;
+    familyNs[opcode >> 12u] += std::max(ns, 0.0);
+    ++familySamples[opcode >> 12u];
+}
+
+// Frames are the subroutines on the CHIP-8 stack, named by the 2nnn target
+// found just before each return address
+void Profiler::Sample(Op op, uint8_t const* memory, uint16_t const* stack, uint8_t sp) {
+    std::string key = "main";
+
+    for (unsigned int level = 0; level < sp && level < STACK_LEVELS; ++level) {
+        uint16_t site = stack[level] - 2;
+        uint16_t call = site < MEMORY_SIZE - 1 ? (memory[site] << 8u) | memory[site + 1] : 0;
+
+        key += ';';
+        key += (call >> 12u) == 0x2 ? "sub_" + Hex(call & 0x0FFFu) : "call_" + Hex(site);
+    }
+
+    key += ';';
+    key += OpName(op);
+    ++stacks[key];
+}
+
+bool Profiler::WriteJson(char const* filename, size_t top) const {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "ERROR: Failed to open profile output\n";
+        return false;
+    }
+
+    out << "{\n  \"instructions\": " << instructions << ",\n  \"handlers\": [";
+
+    bool first = true;
+    for (unsigned int op = 0; op < OP_COUNT; ++op) {
+        if (opCounts[op] == 0) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n")
+            << "    {\"op\": \"" << OpName(static_cast<Op>(op)) << "\", \"count\": " << opCounts[op] << "}";
+        first = false;
+    }
+
+    out << "\n  ],\n  \"hot_pcs\": [";
+    first = true;
+    for (uint16_t pc : Top(pcCounts, top)) {
+        out << (first ? "\n" : ",\n")
+            << "    {\"pc\": \"" << Hex(pc) << "\", \"count\": " << pcCounts[pc] << "}";
+        first = false;
+    }
+
+    out << "\n  ],\n  \"hot_blocks\": [";
+    first = true;
+    for (uint16_t pc : Top(blockCounts, top)) {
+        out << (first ? "\n" : ",\n")
+            << "    {\"start\": \"" << Hex(pc) << "\", \"entries\": " << blockCounts[pc] << "}";
+        first = false;
+    }
+
+    out << "\n  ],\n  \"sample_interval\": " << sampleInterval << ",\n  \"sampled_time\": [";
+    first = true;
+    for (unsigned int family = 0; family < 16; ++family) {
+        if (familySamples[family] == 0) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n")
+            << "    {\"family\": \"" << FAMILY_NAMES[family] << "\", \"samples\": " << familySamples[family]
+            << ", \"mean_ns\": " << familyNs[family] / familySamples[family] << "}";
+        first = false;
+    }
+
+    out << "\n  ]\n}\n";
+    return out.good();
+}
+
+bool Profiler::WriteFolded(char const* filename) const {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cerr << "ERROR: Failed to open folded stack output\n";
+        return false;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> sorted(stacks.begin(), stacks.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    for (auto const& entry : sorted) {
+        out << entry.first << " " << entry.second << "\n";
+    }
+    return out.good();
+}
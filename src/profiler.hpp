@@ -0,0 +1,70 @@
+#pragma once
+#include "chip.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+const unsigned int DEFAULT_SAMPLE_INTERVAL = 1024;   // instructions between timing samples
+const size_t DEFAULT_PROFILE_TOP = 32;
+
+// Execution profile of one or more Chip8 instances, attached with
+// Chip8::SetProfiler. Every instruction is counted by handler, by address
+// and by basic block entry; every sampleInterval-th one is also timed and
+// its CHIP-8 call stack recorded for flame graphs.
+class Profiler {
+
+    public:
+        explicit Profiler(unsigned int sampleInterval = DEFAULT_SAMPLE_INTERVAL);
+
+        void Clear();
+        uint64_t Instructions() const { return instructions; }
+
+        bool WriteJson(char const* filename, size_t top = DEFAULT_PROFILE_TOP) const;
+
+        // One "frame;frame;handler count" line per sampled stack, the input
+        // format of flamegraph.pl and speedscope
+        bool WriteFolded(char const* filename) const;
+
+        // Called by Chip8 before executing an instruction; returns true if
+        // this one should be timed and reported through AddTime
+        bool Record(uint16_t pc, Op op, uint8_t const* memory, uint16_t const* stack, uint8_t sp) {
+            ++instructions;
+            ++opCounts[static_cast<unsigned int>(op)];
+            ++pcCounts[pc];
+
+            if (pc != nextPc) {
+                ++blockCounts[pc];
+            }
+            nextPc = pc + 2;
+
+            if (sampleInterval == 0 || --countdown > 0) {
+                return false;
+            }
+            countdown = sampleInterval;
+            Sample(op, memory, stack, sp);
+            return true;
+        }
+
+        void AddTime(uint16_t opcode, std::chrono::steady_clock::duration elapsed);
+
+    private:
+        unsigned int sampleInterval;
+        unsigned int countdown;
+        uint64_t instructions{};
+        uint16_t nextPc{};
+
+        uint64_t opCounts[OP_COUNT]{};
+        uint64_t pcCounts[MEMORY_SIZE]{};
+        uint64_t blockCounts[MEMORY_SIZE]{};   // entries from anywhere but the previous address
+
+        // Sampled time per high nibble of the opcode
+        double familyNs[16]{};
+        uint64_t familySamples[16]{};
+        double clockOverheadNs{};
+
+        std::unordered_map<std::string, uint64_t> stacks;
+
+        void Sample(Op op, uint8_t const* memory, uint16_t const* stack, uint8_t sp);
+};
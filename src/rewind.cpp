@@ -0,0 +1,183 @@
+#include "rewind.hpp"
+#include <algorithm>
+#include <cstring>
+
+const size_t PAGE_SIZE = 64;
+const size_t STATE_SIZE = sizeof(Chip8State);
+const size_t PAGE_COUNT = (STATE_SIZE + PAGE_SIZE - 1) / PAGE_SIZE;
+const uint8_t END_OF_DELTA = 0xFF;
+
+// Run tokens: 0x00-0x7F = n+1 literal XOR bytes follow, 0x80-0xFF = n+1 unchanged bytes
+const uint8_t ZERO_RUN = 0x80;
+const size_t MAX_RUN = 128;
+
+static_assert(PAGE_COUNT < END_OF_DELTA, "page index must not collide with the end marker");
+
+static void ApplyDelta(uint8_t const* data, size_t size, uint8_t* state) {
+    size_t pos = 0;
+
+    while (pos < size) {
+        uint8_t page = data[pos++];
+        if (page == END_OF_DELTA) {
+            break;
+        }
+
+        uint8_t* bytes = state + page * PAGE_SIZE;
+        size_t length = std::min(PAGE_SIZE, STATE_SIZE - page * PAGE_SIZE);
+        size_t covered = 0;
+
+        while (covered < length) {
+            uint8_t token = data[pos++];
+            size_t run = (token & 0x7Fu) + 1;
+
+            if (!(token & ZERO_RUN)) {
+                for (size_t i = 0; i < run; ++i) {
+                    bytes[covered + i] ^= data[pos++];
+                }
+            }
+            covered += run;
+        }
+    }
+}
+
+RewindBuffer::RewindBuffer(size_t budgetBytes, unsigned int keyframeInterval)
+    : arena(std::max(budgetBytes, 4 * STATE_SIZE)),
+      keyframeInterval(std::max(keyframeInterval, 1u))
+{
+}
+
+void RewindBuffer::Clear() {
+    records.clear();
+    writePos = 0;
+    bytesUsed = 0;
+    sinceKeyframe = 0;
+}
+
+void RewindBuffer::Push(Chip8 const& chip) {
+    chip.SaveState(scratch);
+
+    bool keyframe = records.empty() || sinceKeyframe + 1 >= keyframeInterval;
+    if (keyframe) {
+        uint8_t const* raw = reinterpret_cast<uint8_t const*>(&scratch);
+        encoded.assign(raw, raw + STATE_SIZE);
+    } else {
+        EncodeDelta(last, scratch);
+    }
+
+    Store(keyframe);
+    last = scratch;
+}
+
+unsigned int RewindBuffer::Rewind(Chip8& chip, unsigned int frames) {
+    if (records.empty()) {
+        return 0;
+    }
+
+    size_t newest = records.size() - 1;
+    size_t target = newest - std::min<size_t>(frames, newest);
+
+    size_t key = target;
+    while (!records[key].keyframe) {
+        --key;
+    }
+
+    uint8_t* state = reinterpret_cast<uint8_t*>(&scratch);
+    memcpy(state, &arena[records[key].offset], STATE_SIZE);
+    for (size_t i = key + 1; i <= target; ++i) {
+        ApplyDelta(&arena[records[i].offset], records[i].size, state);
+    }
+
+    while (records.size() > target + 1) {
+        bytesUsed -= records.back().size;
+        records.pop_back();
+    }
+
+    writePos = records.back().offset + records.back().size;
+    sinceKeyframe = static_cast<unsigned int>(target - key);
+    last = scratch;
+    chip.LoadState(scratch);
+
+    return static_cast<unsigned int>(newest - target);
+}
+
+void RewindBuffer::EncodeDelta(Chip8State const& from, Chip8State const& to) {
+    uint8_t const* a = reinterpret_cast<uint8_t const*>(&from);
+    uint8_t const* b = reinterpret_cast<uint8_t const*>(&to);
+    encoded.clear();
+
+    for (size_t page = 0; page < PAGE_COUNT; ++page) {
+        size_t base = page * PAGE_SIZE;
+        size_t length = std::min(PAGE_SIZE, STATE_SIZE - base);
+
+        if (memcmp(a + base, b + base, length) == 0) {
+            continue;
+        }
+
+        encoded.push_back(static_cast<uint8_t>(page));
+
+        size_t i = 0;
+        while (i < length) {
+            size_t run = 0;
+
+            if (a[base + i] == b[base + i]) {
+                while (i + run < length && run < MAX_RUN && a[base + i + run] == b[base + i + run]) {
+                    ++run;
+                }
+                encoded.push_back(static_cast<uint8_t>(ZERO_RUN | (run - 1)));
+            } else {
+                while (i + run < length && run < MAX_RUN && a[base + i + run] != b[base + i + run]) {
+                    ++run;
+                }
+                encoded.push_back(static_cast<uint8_t>(run - 1));
+                for (size_t j = 0; j < run; ++j) {
+                    encoded.push_back(a[base + i + j] ^ b[base + i + j]);
+                }
+            }
+
+            i += run;
+        }
+    }
+
+    encoded.push_back(END_OF_DELTA);
+}
+
+void RewindBuffer::Store(bool keyframe) {
+    Reserve(encoded.size());
+
+    // Making room evicted the frame this delta was based on
+    if (!keyframe && records.empty()) {
+        uint8_t const* raw = reinterpret_cast<uint8_t const*>(&scratch);
+        encoded.assign(raw, raw + STATE_SIZE);
+        keyframe = true;
+        Reserve(encoded.size());
+    }
+
+    memcpy(&arena[writePos], encoded.data(), encoded.size());
+    records.push_back(Record{writePos, static_cast<uint32_t>(encoded.size()), keyframe});
+    writePos += encoded.size();
+    bytesUsed += encoded.size();
+    sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+}
+
+// Frees size bytes at writePos. Records at or after writePos are the
+// oldest, since everything newer was written below it on this lap.
+void RewindBuffer::Reserve(size_t size) {
+    if (writePos + size > arena.size()) {
+        while (!records.empty() && records.front().offset >= writePos) {
+            DropOldest();
+        }
+        writePos = 0;
+    }
+
+    while (!records.empty() && records.front().offset >= writePos && records.front().offset < writePos + size) {
+        DropOldest();
+    }
+}
+
+// Deltas are useless without their keyframe, so whole groups go at once
+void RewindBuffer::DropOldest() {
+    do {
+        bytesUsed -= records.front().size;
+        records.pop_front();
+    } while (!records.empty() && !records.front().keyframe);
+}
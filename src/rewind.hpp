@@ -0,0 +1,55 @@
+#pragma once
+#include "chip.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+const size_t DEFAULT_REWIND_BUDGET_MB = 16;
+const unsigned int DEFAULT_KEYFRAME_INTERVAL = 60;   // one full snapshot per second at 60 Hz
+
+// History of per-frame machine states for stepping backwards. Every
+// keyframeInterval frames a full Chip8State is kept; the frames between
+// store only the 64-byte pages of the state that changed, XORed against
+// the previous frame and run-length encoded. Records live in one ring of
+// budget bytes; the oldest keyframe and its deltas are dropped to make room.
+class RewindBuffer {
+
+    public:
+        explicit RewindBuffer(size_t budgetBytes = DEFAULT_REWIND_BUDGET_MB << 20,
+                              unsigned int keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+        // Records the chip's current state as the newest frame
+        void Push(Chip8 const& chip);
+
+        // Restores the state from the given number of frames back and
+        // forgets everything newer; returns how many frames were rewound
+        unsigned int Rewind(Chip8& chip, unsigned int frames);
+
+        void Clear();
+        size_t Frames() const { return records.size(); }
+        size_t BytesUsed() const { return bytesUsed; }
+
+    private:
+        struct Record {
+            size_t offset;
+            uint32_t size;
+            bool keyframe;
+        };
+
+        std::vector<uint8_t> arena;
+        std::deque<Record> records;
+        size_t writePos{};
+        size_t bytesUsed{};
+        unsigned int keyframeInterval;
+        unsigned int sinceKeyframe{};
+
+        Chip8State last{};        // state of the newest record
+        Chip8State scratch{};
+        std::vector<uint8_t> encoded;
+
+        void EncodeDelta(Chip8State const& from, Chip8State const& to);
+        void Store(bool keyframe);
+        void Reserve(size_t size);
+        void DropOldest();
+};
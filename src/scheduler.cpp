@@ -0,0 +1,74 @@
+#include "scheduler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// Bounds for the spin window, which tracks twice the measured sleep overshoot
+const std::chrono::microseconds MIN_SPIN(100);
+const std::chrono::microseconds MAX_SPIN(2000);
+
+// Deadlines further behind than this are dropped instead of caught up
+const unsigned int MAX_LAG_FRAMES = 4;
+
+FrameScheduler::FrameScheduler(unsigned int frameRate)
+    : period(std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frameRate)))
+{
+    Reset();
+}
+
+void FrameScheduler::Reset() {
+    deadline = Clock::now() + period;
+    lastFrame = Clock::now();
+    frames = 0;
+    intervalSum = 0.0;
+    intervalSquareSum = 0.0;
+    maxLate = 0.0;
+    spin = std::chrono::duration_cast<Clock::duration>(MAX_SPIN) / 2;
+    sleepOvershoot = Clock::duration::zero();
+}
+
+void FrameScheduler::WaitForNextFrame() {
+    auto now = Clock::now();
+
+    if (deadline - now > spin) {
+        auto wake = deadline - spin;
+        std::this_thread::sleep_until(wake);
+
+        // Moving average of how far past the requested time sleeps return
+        now = Clock::now();
+        sleepOvershoot += (now - wake - sleepOvershoot) / 8;
+        spin = std::clamp<Clock::duration>(sleepOvershoot * 2, MIN_SPIN, MAX_SPIN);
+    }
+
+    while ((now = Clock::now()) < deadline) {
+        std::this_thread::yield();
+    }
+
+    double late = std::chrono::duration<double, std::milli>(now - deadline).count();
+    double interval = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+
+    maxLate = std::max(maxLate, late);
+    intervalSum += interval;
+    intervalSquareSum += interval * interval;
+    ++frames;
+    lastFrame = now;
+
+    deadline += period;
+    if (now - deadline > period * MAX_LAG_FRAMES) {
+        deadline = now + period;
+    }
+}
+
+FrameStats FrameScheduler::Stats() const {
+    FrameStats stats{};
+    stats.frames = frames;
+    stats.maxLateMs = maxLate;
+
+    if (frames > 0) {
+        stats.meanFrameMs = intervalSum / frames;
+        double variance = intervalSquareSum / frames - stats.meanFrameMs * stats.meanFrameMs;
+        stats.jitterMs = std::sqrt(std::max(0.0, variance));
+    }
+
+    return stats;
+}
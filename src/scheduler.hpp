@@ -0,0 +1,40 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+const unsigned int FRAME_RATE = 60;
+const unsigned int DEFAULT_CYCLES_PER_FRAME = 11;   // ~660 instructions per second
+
+struct FrameStats {
+    uint64_t frames;
+    double meanFrameMs;     // average time between frame starts
+    double jitterMs;        // standard deviation of that interval
+    double maxLateMs;       // worst wake-up past a deadline
+};
+
+// Paces a loop to a fixed frame rate. Sleeps until shortly before each
+// deadline and spins the remainder, since OS sleeps routinely overshoot;
+// the spin window adapts to the overshoot actually observed.
+class FrameScheduler {
+
+    public:
+        explicit FrameScheduler(unsigned int frameRate = FRAME_RATE);
+
+        void WaitForNextFrame();
+        void Reset();
+        FrameStats Stats() const;
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        Clock::duration period;
+        Clock::time_point deadline;
+        Clock::time_point lastFrame;
+        Clock::duration spin;
+        Clock::duration sleepOvershoot;
+
+        uint64_t frames{};
+        double intervalSum{};
+        double intervalSquareSum{};
+        double maxLate{};
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer, single-consumer FIFO. Push() and Pop() never
+// block or allocate; a full queue makes Push() fail instead. Each index is
+// written by one side only and sits on its own cache line.
+template <typename T, size_t Capacity>
+class SpscQueue {
+
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    public:
+        // Producer side; false if the queue is full
+        bool Push(T const& value) {
+            size_t tail = tailIndex.load(std::memory_order_relaxed);
+            if (tail - headCache == Capacity) {
+                headCache = headIndex.load(std::memory_order_acquire);
+                if (tail - headCache == Capacity) {
+                    return false;
+                }
+            }
+
+            items[tail & (Capacity - 1)] = value;
+            tailIndex.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side; false if the queue is empty
+        bool Pop(T& value) {
+            size_t head = headIndex.load(std::memory_order_relaxed);
+            if (head == tailCache) {
+                tailCache = tailIndex.load(std::memory_order_acquire);
+                if (head == tailCache) {
+                    return false;
+                }
+            }
+
+            value = items[head & (Capacity - 1)];
+            headIndex.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side; the oldest item without removing it
+        T const* Peek() {
+            size_t head = headIndex.load(std::memory_order_relaxed);
+            if (head == tailCache) {
+                tailCache = tailIndex.load(std::memory_order_acquire);
+                if (head == tailCache) {
+                    return nullptr;
+                }
+            }
+            return &items[head & (Capacity - 1)];
+        }
+
+    private:
+        // Each side also keeps a cached copy of the other's index, so the
+        // shared line is only read when the queue looks full or empty
+        alignas(64) std::atomic<size_t> tailIndex{0};
+        size_t headCache{0};
+        alignas(64) std::atomic<size_t> headIndex{0};
+        size_t tailCache{0};
+        alignas(64) T items[Capacity]{};
+};
@@ -0,0 +1,98 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned int i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned int i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Raised under the idle lock so a worker about to sleep cannot miss it,
+    // and before the push so a worker's decrement can never run ahead of it
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+
+    Queue& queue = *queues[nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(idleMutex);
+    done.wait(lock, [this] { return pending.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::TryPop(unsigned int self, std::function<void()>& task) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue& victim = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::WorkerLoop(unsigned int self) {
+    std::function<void()> task;
+
+    while (true) {
+        if (TryPop(self, task)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            task();
+            task = nullptr;
+
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idleMutex);
+        wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task deque. A worker
+// takes its newest task first and, when its deque runs dry, steals the
+// oldest task of another worker, so uneven jobs still keep every core busy.
+class ThreadPool {
+
+    public:
+        explicit ThreadPool(unsigned int threads = 0);    // 0 = one per hardware thread
+        ~ThreadPool();
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        unsigned int Size() const { return static_cast<unsigned int>(workers.size()); }
+
+        void Submit(std::function<void()> task);
+
+        // Blocks until every submitted task has finished
+        void Wait();
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<unsigned int> nextQueue{};
+        std::atomic<size_t> queued{};     // sitting in a deque
+        std::atomic<size_t> pending{};    // submitted and not yet finished
+
+        std::mutex idleMutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        bool stopping{};
+
+        bool TryPop(unsigned int self, std::function<void()>& task);
+        void WorkerLoop(unsigned int self);
+};
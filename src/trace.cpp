@@ -0,0 +1,461 @@
+#include "trace.hpp"
+#include "lz.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+const size_t FILE_HEADER_SIZE = 8;
+const size_t CHUNK_HEADER_SIZE = 46;
+const size_t FOOTER_SIZE = 20;
+const size_t MAX_RECORD_BYTES = 7 + REGISTER_COUNT + 2 + 3 + 3 + REGISTER_COUNT;
+
+static void Put(std::vector<uint8_t>& out, uint64_t value, unsigned int bytes) {
+    for (unsigned int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static uint64_t Get(uint8_t const* in, unsigned int bytes) {
+    uint64_t value = 0;
+    for (unsigned int i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+static void PutRegs(std::vector<uint8_t>& out, TraceRegs const& regs) {
+    out.insert(out.end(), regs.V, regs.V + REGISTER_COUNT);
+    Put(out, regs.index, 2);
+    out.push_back(regs.sp);
+    out.push_back(regs.delayTimer);
+    out.push_back(regs.soundTimer);
+}
+
+static void GetRegs(uint8_t const* in, TraceRegs& regs) {
+    std::copy(in, in + REGISTER_COUNT, regs.V);
+    regs.index = static_cast<uint16_t>(Get(in + REGISTER_COUNT, 2));
+    regs.sp = in[REGISTER_COUNT + 2];
+    regs.delayTimer = in[REGISTER_COUNT + 3];
+    regs.soundTimer = in[REGISTER_COUNT + 4];
+}
+
+TraceWriter::~TraceWriter() {
+    Close();
+}
+
+bool TraceWriter::Open(char const* filename, bool compressChunks) {
+    Close();
+
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open trace file\n";
+        return false;
+    }
+
+    std::vector<uint8_t> header;
+    Put(header, TRACE_MAGIC, 4);
+    Put(header, TRACE_VERSION, 2);
+    Put(header, 0, 2);
+    file.write(reinterpret_cast<char const*>(header.data()), header.size());
+
+    compress = compressChunks;
+    instructions = 0;
+    offset = header.size();
+    chunkFirsts.clear();
+    chunkOffsets.clear();
+    filling = Chunk{};
+    filling.data.reserve(TRACE_CHUNK_BYTES + MAX_RECORD_BYTES);
+    hasPending = false;
+    closing = false;
+    writer = std::thread(&TraceWriter::WriterLoop, this);
+
+    return true;
+}
+
+void TraceWriter::Close() {
+    if (!writer.joinable()) {
+        return;
+    }
+
+    if (filling.count > 0) {
+        Submit();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    writer.join();
+
+    std::vector<uint8_t> footer;
+    for (size_t i = 0; i < chunkFirsts.size(); ++i) {
+        Put(footer, chunkFirsts[i], 8);
+        Put(footer, chunkOffsets[i], 8);
+    }
+    Put(footer, instructions, 8);
+    Put(footer, chunkFirsts.size(), 8);
+    Put(footer, TRACE_INDEX_MAGIC, 4);
+    file.write(reinterpret_cast<char const*>(footer.data()), footer.size());
+    file.close();
+}
+
+void TraceWriter::Record(uint16_t pc, uint16_t opcode, TraceRegs const& before, TraceRegs const& after,
+                         uint16_t storeAddress, uint8_t const* stored, uint8_t storeLength) {
+    if (filling.count == 0) {
+        filling.first = instructions;
+        filling.start = before;
+        last = before;
+    }
+
+    // Compared with what the reader last saw rather than with before, so
+    // changes made between instructions (timer ticks, LoadState) land in
+    // this record
+    uint16_t mask = 0;
+    for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+        mask |= (last.V[i] != after.V[i] ? 1u : 0u) << i;
+    }
+
+    uint8_t flags = 0;
+    flags |= last.index != after.index ? TRACE_INDEX : 0;
+    flags |= last.delayTimer != after.delayTimer ? TRACE_DELAY : 0;
+    flags |= last.soundTimer != after.soundTimer ? TRACE_SOUND : 0;
+    flags |= last.sp != after.sp ? TRACE_SP : 0;
+    flags |= stored ? TRACE_STORE : 0;
+
+    // Written through a pointer into space for the largest possible record
+    std::vector<uint8_t>& out = filling.data;
+    size_t start = out.size();
+    out.resize(start + MAX_RECORD_BYTES);
+    uint8_t* p = &out[start];
+
+    p[0] = static_cast<uint8_t>(pc);
+    p[1] = static_cast<uint8_t>(pc >> 8);
+    p[2] = static_cast<uint8_t>(opcode);
+    p[3] = static_cast<uint8_t>(opcode >> 8);
+    p[4] = static_cast<uint8_t>(mask);
+    p[5] = static_cast<uint8_t>(mask >> 8);
+    p[6] = flags;
+    p += 7;
+
+    for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+        if (mask & (1u << i)) {
+            *p++ = after.V[i];
+        }
+    }
+    if (flags & TRACE_INDEX) {
+        *p++ = static_cast<uint8_t>(after.index);
+        *p++ = static_cast<uint8_t>(after.index >> 8);
+    }
+    if (flags & TRACE_DELAY) {
+        *p++ = after.delayTimer;
+    }
+    if (flags & TRACE_SOUND) {
+        *p++ = after.soundTimer;
+    }
+    if (flags & TRACE_SP) {
+        *p++ = after.sp;
+    }
+    if (flags & TRACE_STORE) {
+        *p++ = static_cast<uint8_t>(storeAddress);
+        *p++ = static_cast<uint8_t>(storeAddress >> 8);
+        *p++ = storeLength;
+        memcpy(p, stored, storeLength);
+        p += storeLength;
+    }
+
+    out.resize(static_cast<size_t>(p - out.data()));
+
+    last = after;
+    ++filling.count;
+    ++instructions;
+
+    if (out.size() >= TRACE_CHUNK_BYTES) {
+        Submit();
+    }
+}
+
+// Swaps the full chunk with the writer's, waiting only while the writer
+// is still busy with the previous one
+void TraceWriter::Submit() {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return !hasPending; });
+        std::swap(filling, pending);
+        hasPending = true;
+    }
+    changed.notify_all();
+
+    filling.data.clear();
+    filling.count = 0;
+}
+
+void TraceWriter::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        changed.wait(lock, [this] { return hasPending || closing; });
+        if (!hasPending) {
+            break;
+        }
+
+        lock.unlock();
+        WriteChunk(pending);
+        lock.lock();
+
+        hasPending = false;
+        changed.notify_all();
+    }
+}
+
+void TraceWriter::WriteChunk(Chunk const& chunk) {
+    uint8_t const* data = chunk.data.data();
+    size_t size = chunk.data.size();
+    uint8_t compression = TRACE_RAW;
+
+    if (compress) {
+        compressed.resize(LzBound(size));
+        size_t packed = LzCompress(data, size, compressed.data());
+        if (packed < size) {
+            data = compressed.data();
+            size = packed;
+            compression = TRACE_LZ;
+        }
+    }
+
+    std::vector<uint8_t> header;
+    Put(header, TRACE_CHUNK_MAGIC, 4);
+    Put(header, chunk.first, 8);
+    Put(header, chunk.count, 4);
+    Put(header, chunk.data.size(), 4);
+    Put(header, size, 4);
+    header.push_back(compression);
+    PutRegs(header, chunk.start);
+
+    chunkFirsts.push_back(chunk.first);
+    chunkOffsets.push_back(offset);
+
+    file.write(reinterpret_cast<char const*>(header.data()), header.size());
+    file.write(reinterpret_cast<char const*>(data), size);
+    offset += header.size() + size;
+}
+
+bool TraceReader::Open(char const* filename) {
+    file.open(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open trace file\n";
+        return false;
+    }
+
+    uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    uint8_t header[FILE_HEADER_SIZE];
+    file.seekg(0);
+    if (fileSize < FILE_HEADER_SIZE || !file.read(reinterpret_cast<char*>(header), sizeof(header))
+        || Get(header, 4) != TRACE_MAGIC || Get(header + 4, 2) != TRACE_VERSION) {
+        std::cerr << "ERROR: Not a trace file or unsupported version\n";
+        return false;
+    }
+
+    // A trace cut short has no index; walk the chunk headers instead
+    if (!ReadIndex(fileSize) && !ScanChunks(fileSize)) {
+        return false;
+    }
+
+    chunkEnd = 0;
+    next = 0;
+    return chunks.empty() || LoadChunk(0);
+}
+
+bool TraceReader::ReadIndex(uint64_t fileSize) {
+    if (fileSize < FILE_HEADER_SIZE + FOOTER_SIZE) {
+        return false;
+    }
+
+    uint8_t footer[FOOTER_SIZE];
+    file.seekg(fileSize - FOOTER_SIZE);
+    if (!file.read(reinterpret_cast<char*>(footer), sizeof(footer)) || Get(footer + 16, 4) != TRACE_INDEX_MAGIC) {
+        file.clear();
+        return false;
+    }
+
+    uint64_t count = Get(footer + 8, 8);
+    if (count > (fileSize - FILE_HEADER_SIZE - FOOTER_SIZE) / 16) {
+        return false;
+    }
+
+    std::vector<uint8_t> entries(count * 16);
+    file.seekg(fileSize - FOOTER_SIZE - entries.size());
+    if (!file.read(reinterpret_cast<char*>(entries.data()), entries.size())) {
+        file.clear();
+        return false;
+    }
+
+    chunks.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        chunks.push_back(ChunkInfo{Get(&entries[i * 16], 8), Get(&entries[i * 16 + 8], 8)});
+    }
+    total = Get(footer, 8);
+    return true;
+}
+
+bool TraceReader::ScanChunks(uint64_t fileSize) {
+    chunks.clear();
+    total = 0;
+    uint64_t offset = FILE_HEADER_SIZE;
+
+    while (offset + CHUNK_HEADER_SIZE <= fileSize) {
+        uint8_t header[CHUNK_HEADER_SIZE];
+        file.seekg(offset);
+        if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || Get(header, 4) != TRACE_CHUNK_MAGIC) {
+            break;
+        }
+
+        uint64_t stored = Get(header + 20, 4);
+        if (offset + CHUNK_HEADER_SIZE + stored > fileSize) {
+            break;
+        }
+
+        chunks.push_back(ChunkInfo{Get(header + 4, 8), offset});
+        total = Get(header + 4, 8) + Get(header + 12, 4);
+        offset += CHUNK_HEADER_SIZE + stored;
+    }
+
+    file.clear();
+    std::cerr << "WARNING: Trace has no index, recovered " << chunks.size() << " chunks\n";
+    return true;
+}
+
+bool TraceReader::LoadChunk(size_t index) {
+    uint8_t header[CHUNK_HEADER_SIZE];
+    file.seekg(chunks[index].offset);
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || Get(header, 4) != TRACE_CHUNK_MAGIC) {
+        std::cerr << "ERROR: Corrupt trace chunk\n";
+        return false;
+    }
+
+    uint64_t first = Get(header + 4, 8);
+    uint32_t count = static_cast<uint32_t>(Get(header + 12, 4));
+    size_t rawSize = Get(header + 16, 4);
+    size_t stored = Get(header + 20, 4);
+    uint8_t compression = header[24];
+
+    std::vector<uint8_t> data(stored);
+    if (!file.read(reinterpret_cast<char*>(data.data()), stored)) {
+        std::cerr << "ERROR: Truncated trace chunk\n";
+        return false;
+    }
+
+    if (compression == TRACE_LZ) {
+        raw.resize(rawSize);
+        if (!LzDecompress(data.data(), data.size(), raw.data(), rawSize)) {
+            std::cerr << "ERROR: Corrupt compressed trace chunk\n";
+            return false;
+        }
+    } else {
+        raw.swap(data);
+    }
+
+    GetRegs(header + 25, regs);
+    chunk = index;
+    pos = 0;
+    next = first;
+    chunkEnd = first + count;
+    return true;
+}
+
+bool TraceReader::Seek(uint64_t instruction) {
+    if (instruction >= total) {
+        return false;
+    }
+
+    auto after = std::upper_bound(chunks.begin(), chunks.end(), instruction, [](uint64_t n, ChunkInfo const& info) {
+        return n < info.first;
+    });
+    if (after == chunks.begin() || !LoadChunk(static_cast<size_t>(after - chunks.begin()) - 1)) {
+        return false;
+    }
+
+    TraceRecord skipped;
+    while (next < instruction) {
+        if (!Decode(skipped)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TraceReader::Next(TraceRecord& record) {
+    while (next >= chunkEnd) {
+        if (chunk + 1 >= chunks.size() || !LoadChunk(chunk + 1)) {
+            return false;
+        }
+    }
+    return Decode(record);
+}
+
+bool TraceReader::Decode(TraceRecord& record) {
+    if (raw.size() - pos < 7) {
+        return false;
+    }
+
+    uint8_t const* in = raw.data() + pos;
+    uint8_t const* end = raw.data() + raw.size();
+
+    record.instruction = next;
+    record.pc = static_cast<uint16_t>(Get(in, 2));
+    record.opcode = static_cast<uint16_t>(Get(in + 2, 2));
+    record.changed = static_cast<uint16_t>(Get(in + 4, 2));
+    record.flags = in[6];
+    in += 7;
+
+    // Bytes the flags and mask say follow
+    size_t needed = 0;
+    for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+        needed += (record.changed >> i) & 1u;
+    }
+    needed += (record.flags & TRACE_INDEX) ? 2 : 0;
+    needed += (record.flags & TRACE_DELAY) ? 1 : 0;
+    needed += (record.flags & TRACE_SOUND) ? 1 : 0;
+    needed += (record.flags & TRACE_SP) ? 1 : 0;
+    needed += (record.flags & TRACE_STORE) ? 3 : 0;
+    if (static_cast<size_t>(end - in) < needed) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+        if (record.changed & (1u << i)) {
+            regs.V[i] = *in++;
+        }
+    }
+    if (record.flags & TRACE_INDEX) {
+        regs.index = static_cast<uint16_t>(Get(in, 2));
+        in += 2;
+    }
+    if (record.flags & TRACE_DELAY) {
+        regs.delayTimer = *in++;
+    }
+    if (record.flags & TRACE_SOUND) {
+        regs.soundTimer = *in++;
+    }
+    if (record.flags & TRACE_SP) {
+        regs.sp = *in++;
+    }
+
+    record.storeAddress = 0;
+    record.storeLength = 0;
+    if (record.flags & TRACE_STORE) {
+        record.storeAddress = static_cast<uint16_t>(Get(in, 2));
+        record.storeLength = in[2];
+        in += 3;
+        if (record.storeLength > REGISTER_COUNT || static_cast<size_t>(end - in) < record.storeLength) {
+            return false;
+        }
+        std::copy(in, in + record.storeLength, record.stored);
+        in += record.storeLength;
+    }
+
+    record.regs = regs;
+    pos = static_cast<size_t>(in - raw.data());
+    ++next;
+    return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "chip.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Instruction-level execution trace. The file is a header, a sequence of
+// independently (optionally LZ) compressed chunks of records and an index
+// of chunk offsets, so a reader can jump to any instruction by decoding a
+// single chunk. Each chunk starts with a full register snapshot; records
+// then hold what changed since the previous record, including changes
+// made between instructions such as timer ticks.
+//
+// Record: pc u16, opcode u16, changed-register mask u16, flags u8, then
+// one byte per changed Vx, and per flag: I u16, delay u8, sound u8, sp u8,
+// store address u16 + length u8 + bytes.
+
+const uint32_t TRACE_MAGIC = 0x52543843;         // "C8TR"
+const uint32_t TRACE_CHUNK_MAGIC = 0x43543843;   // "C8TC"
+const uint32_t TRACE_INDEX_MAGIC = 0x49543843;   // "C8TI"
+const uint16_t TRACE_VERSION = 1;
+const size_t TRACE_CHUNK_BYTES = 64 << 10;
+
+const uint8_t TRACE_INDEX = 0x01;
+const uint8_t TRACE_DELAY = 0x02;
+const uint8_t TRACE_SOUND = 0x04;
+const uint8_t TRACE_SP = 0x08;
+const uint8_t TRACE_STORE = 0x10;
+
+const uint8_t TRACE_RAW = 0;
+const uint8_t TRACE_LZ = 1;
+
+// Registers a trace follows between instructions
+struct TraceRegs {
+    uint8_t V[REGISTER_COUNT];
+    uint16_t index;
+    uint8_t sp;
+    uint8_t delayTimer;
+    uint8_t soundTimer;
+};
+
+// Collects records on the emulation thread and hands full chunks to a
+// writer thread; the emulator only waits if the writer is still busy with
+// the previous chunk when the next one fills.
+class TraceWriter {
+
+    public:
+        TraceWriter() = default;
+        ~TraceWriter();
+        TraceWriter(TraceWriter const&) = delete;
+        TraceWriter& operator=(TraceWriter const&) = delete;
+
+        bool Open(char const* filename, bool compress);
+        void Close();
+        uint64_t Instructions() const { return instructions; }
+
+        // stored points at the bytes an Fx55/Fx33 wrote, or is null
+        void Record(uint16_t pc, uint16_t opcode, TraceRegs const& before, TraceRegs const& after,
+                    uint16_t storeAddress, uint8_t const* stored, uint8_t storeLength);
+
+    private:
+        struct Chunk {
+            std::vector<uint8_t> data;
+            uint64_t first{};
+            uint32_t count{};
+            TraceRegs start{};
+        };
+
+        std::ofstream file;
+        bool compress{};
+        uint64_t instructions{};
+
+        Chunk filling;
+        TraceRegs last{};       // registers as the reader will have rebuilt them
+        Chunk pending;
+        bool hasPending{};
+        bool closing{};
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::thread writer;
+
+        // Writer thread only
+        uint64_t offset{};
+        std::vector<uint64_t> chunkFirsts;
+        std::vector<uint64_t> chunkOffsets;
+        std::vector<uint8_t> compressed;
+
+        void Submit();
+        void WriterLoop();
+        void WriteChunk(Chunk const& chunk);
+};
+
+// One decoded record, with registers as they were after the instruction
+struct TraceRecord {
+    uint64_t instruction;
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t changed;        // bit n = Vn written with a new value
+    uint8_t flags;           // TRACE_* bits
+    TraceRegs regs;
+    uint16_t storeAddress;
+    uint8_t storeLength;
+    uint8_t stored[REGISTER_COUNT];
+};
+
+class TraceReader {
+
+    public:
+        bool Open(char const* filename);
+        uint64_t Instructions() const { return total; }
+
+        // Positions the reader so Next returns the given instruction
+        bool Seek(uint64_t instruction);
+        bool Next(TraceRecord& record);
+
+    private:
+        struct ChunkInfo {
+            uint64_t first;
+            uint64_t offset;
+        };
+
+        std::ifstream file;
+        std::vector<ChunkInfo> chunks;
+        uint64_t total{};
+
+        size_t chunk{};
+        std::vector<uint8_t> raw;
+        size_t pos{};
+        uint64_t next{};
+        uint64_t chunkEnd{};
+        TraceRegs regs{};
+
+        bool ReadIndex(uint64_t fileSize);
+        bool ScanChunks(uint64_t fileSize);
+        bool LoadChunk(size_t index);
+        bool Decode(TraceRecord& record);
+};
@@ -0,0 +1,83 @@
+#include "chip.hpp"
+#include "trace.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Prints a range of instructions from a trace file, one per line, with the
+// registers each one changed and the bytes it stored.
+
+const uint64_t DEFAULT_COUNT = 32;
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc % 2 == 1) {
+        std::cerr << "Usage: " << argv[0] << " <Trace> [--from N] [--count N]\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    uint64_t from = 0;
+    uint64_t count = DEFAULT_COUNT;
+
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+
+        if (option == "--from") {
+            from = std::stoull(argv[i + 1]);
+        } else if (option == "--count") {
+            count = std::stoull(argv[i + 1]);
+        } else {
+            std::cerr << "Unknown option: " << option << "\n";
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    TraceReader reader;
+    if (!reader.Open(argv[1])) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    printf("instructions: %llu\n", static_cast<unsigned long long>(reader.Instructions()));
+
+    if (count == 0 || from >= reader.Instructions()) {
+        return 0;
+    }
+    if (!reader.Seek(from)) {
+        std::cerr << "ERROR: Failed to seek to instruction " << from << "\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    TraceRecord record;
+    for (uint64_t n = 0; n < count && reader.Next(record); ++n) {
+        printf("%10llu  %03X  %04X  %-4s", static_cast<unsigned long long>(record.instruction),
+               record.pc, record.opcode, OpName(Chip8::Decode(record.opcode).op));
+
+        for (unsigned int i = 0; i < REGISTER_COUNT; ++i) {
+            if (record.changed & (1u << i)) {
+                printf("  V%X=%02X", i, record.regs.V[i]);
+            }
+        }
+        if (record.flags & TRACE_INDEX) {
+            printf("  I=%03X", record.regs.index);
+        }
+        if (record.flags & TRACE_DELAY) {
+            printf("  DT=%02X", record.regs.delayTimer);
+        }
+        if (record.flags & TRACE_SOUND) {
+            printf("  ST=%02X", record.regs.soundTimer);
+        }
+        if (record.flags & TRACE_SP) {
+            printf("  SP=%X", record.regs.sp);
+        }
+        if (record.flags & TRACE_STORE) {
+            printf("  [%03X]=", record.storeAddress);
+            for (unsigned int i = 0; i < record.storeLength; ++i) {
+                printf("%02X", record.stored[i]);
+            }
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
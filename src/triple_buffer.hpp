@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Single-producer, single-consumer handoff of the latest value. The
+// producer fills Back() and publishes it; the consumer takes whatever was
+// published last. Neither side ever waits on the other, and values the
+// consumer was too slow to take are simply overwritten.
+template <typename T>
+class TripleBuffer {
+
+    public:
+        // Producer side
+        T& Back() { return buffers[back]; }
+
+        void Publish() {
+            uint8_t previous = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+            back = previous & INDEX;
+        }
+
+        // Consumer side; returns false if nothing new was published since
+        // the last call, in which case Front() is unchanged
+        bool Acquire() {
+            if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+                return false;
+            }
+
+            uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+            front = previous & INDEX;
+            return true;
+        }
+
+        T const& Front() const { return buffers[front]; }
+
+    private:
+        static const uint8_t INDEX = 0x3;
+        static const uint8_t FRESH = 0x4;
+
+        T buffers[3]{};
+        uint8_t back{0};
+        uint8_t front{1};
+        std::atomic<uint8_t> middle{2};
+};
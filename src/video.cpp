@@ -0,0 +1,131 @@
+#include "video.hpp"
+#include "chip.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CHIP8_VIDEO_X86 1
+#include <immintrin.h>
+#endif
+
+void ExpandRowsScalar(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off) {
+    for (unsigned int y = firstRow; y < firstRow + rowCount; ++y) {
+        uint64_t row = rows[y];
+        uint32_t* out = pixels + y * VIDEO_WIDTH;
+
+        for (unsigned int x = 0; x < VIDEO_WIDTH; ++x) {
+            out[x] = ((row >> (63u - x)) & 1u) ? on : off;
+        }
+    }
+}
+
+#if defined(CHIP8_VIDEO_X86)
+
+// Each half of a row is broadcast to every lane, ANDed with one single-bit
+// mask per lane and compared against it to get an all-ones lane per lit pixel.
+__attribute__((target("sse2")))
+void ExpandRowsSSE2(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off) {
+    __m128i onColour = _mm_set1_epi32(static_cast<int>(on));
+    __m128i offColour = _mm_set1_epi32(static_cast<int>(off));
+    __m128i firstMask = _mm_set_epi32(1 << 28, 1 << 29, 1 << 30, static_cast<int>(1u << 31));
+
+    for (unsigned int y = firstRow; y < firstRow + rowCount; ++y) {
+        uint32_t* out = pixels + y * VIDEO_WIDTH;
+
+        for (unsigned int half = 0; half < 2; ++half) {
+            __m128i bits = _mm_set1_epi32(static_cast<int>(rows[y] >> (32u * (1u - half))));
+            __m128i mask = firstMask;
+
+            for (unsigned int x = 0; x < 32; x += 4) {
+                __m128i lit = _mm_cmpeq_epi32(_mm_and_si128(bits, mask), mask);
+                __m128i colour = _mm_or_si128(_mm_and_si128(lit, onColour), _mm_andnot_si128(lit, offColour));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + half * 32 + x), colour);
+                mask = _mm_srli_epi32(mask, 4);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+void ExpandRowsAVX2(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off) {
+    __m256i onColour = _mm256_set1_epi32(static_cast<int>(on));
+    __m256i offColour = _mm256_set1_epi32(static_cast<int>(off));
+    __m256i firstMask = _mm256_set_epi32(1 << 24, 1 << 25, 1 << 26, 1 << 27,
+                                         1 << 28, 1 << 29, 1 << 30, static_cast<int>(1u << 31));
+
+    for (unsigned int y = firstRow; y < firstRow + rowCount; ++y) {
+        uint32_t* out = pixels + y * VIDEO_WIDTH;
+
+        for (unsigned int half = 0; half < 2; ++half) {
+            __m256i bits = _mm256_set1_epi32(static_cast<int>(rows[y] >> (32u * (1u - half))));
+            __m256i mask = firstMask;
+
+            for (unsigned int x = 0; x < 32; x += 8) {
+                __m256i lit = _mm256_cmpeq_epi32(_mm256_and_si256(bits, mask), mask);
+                __m256i colour = _mm256_blendv_epi8(offColour, onColour, lit);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + half * 32 + x), colour);
+                mask = _mm256_srli_epi32(mask, 8);
+            }
+        }
+    }
+}
+
+static ExpandRowsFunc SelectKernel(char const** name) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return ExpandRowsAVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        *name = "sse2";
+        return ExpandRowsSSE2;
+    }
+    *name = "scalar";
+    return ExpandRowsScalar;
+}
+
+#else
+
+void ExpandRowsSSE2(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off) {
+    ExpandRowsScalar(rows, pixels, firstRow, rowCount, on, off);
+}
+
+void ExpandRowsAVX2(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off) {
+    ExpandRowsScalar(rows, pixels, firstRow, rowCount, on, off);
+}
+
+static ExpandRowsFunc SelectKernel(char const** name) {
+    *name = "scalar";
+    return ExpandRowsScalar;
+}
+
+#endif
+
+static char const* kernelName = "scalar";
+
+static ExpandRowsFunc Kernel() {
+    static ExpandRowsFunc const kernel = SelectKernel(&kernelName);
+    return kernel;
+}
+
+void ExpandRows(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off) {
+    Kernel()(rows, pixels, firstRow, rowCount, on, off);
+}
+
+char const* ExpandRowsKernel() {
+    Kernel();
+    return kernelName;
+}
+
+// Each row is folded in with a multiply, then the murmur3 finalizer
+// spreads every input bit over the result
+uint64_t HashVideo(uint64_t const* rows) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull;
+    for (unsigned int y = 0; y < VIDEO_HEIGHT; ++y) {
+        hash = (hash ^ rows[y]) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+// Converts packed framebuffer rows (Chip8::video) to one 32-bit colour per
+// pixel. rows and pixels both describe the full 64x32 screen; only rows
+// [firstRow, firstRow + rowCount) are written.
+typedef void (*ExpandRowsFunc)(uint64_t const* rows, uint32_t* pixels,
+                               unsigned int firstRow, unsigned int rowCount,
+                               uint32_t on, uint32_t off);
+
+void ExpandRowsScalar(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off);
+void ExpandRowsSSE2(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off);
+void ExpandRowsAVX2(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off);
+
+// Fastest kernel the running CPU supports, chosen on first use
+void ExpandRows(uint64_t const* rows, uint32_t* pixels, unsigned int firstRow, unsigned int rowCount, uint32_t on, uint32_t off);
+char const* ExpandRowsKernel();
+
+// Fast non-cryptographic hash of a whole framebuffer, one row per step
+uint64_t HashVideo(uint64_t const* rows);
+
+// Calls f(firstRow, rowCount) for each run of set bits in a dirty-row mask
+template <typename F>
+void ForEachRowSpan(uint32_t mask, F f) {
+    unsigned int row = 0;
+    while (row < 32) {
+        if (!(mask & (1u << row))) {
+            ++row;
+            continue;
+        }
+
+        unsigned int first = row;
+        while (row < 32 && (mask & (1u << row))) {
+            ++row;
+        }
+        f(first, row - first);
+    }
+}
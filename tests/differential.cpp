@@ -0,0 +1,282 @@
+#include "aot.hpp"
+#include "batch.hpp"
+#include "chip.hpp"
+#include "jit.hpp"
+#include "log.hpp"
+#include "rom_gen.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Runs generated ROMs through every way this tree can execute them and
+// compares the full state hash after every frame against the switch core
+// without idle skipping. Exits non-zero on the first divergence of each
+// engine and ROM, printing where it happened.
+
+// Built from the ROM RomGenerator makes for CHIP8_AOT_TEST_SEED
+extern const AotProgram chip8AotProgram;
+
+const unsigned int ROM_COUNT = 64;
+const unsigned int FRAMES = 120;
+const unsigned int BATCH_LANES = 8;
+const unsigned int AOT_SEEDS = 64;
+
+struct Case {
+    std::vector<uint8_t> rom;
+    uint64_t seed;
+    unsigned int cyclesPerFrame;
+};
+
+typedef std::vector<uint64_t> Hashes;
+typedef std::function<void(Chip8& chip, unsigned int cycles)> FrameFunc;
+
+// Held keys change every few frames, and are often all released, so
+// Ex9E/ExA1 take both branches and Fx0A waits end
+static uint16_t KeysAt(Case const& test, unsigned int frame) {
+    uint64_t bits = Chip8::SeedState(test.seed * 1000 + frame / 8);
+    return (bits & 1) ? static_cast<uint16_t>(bits >> 8) : 0;
+}
+
+static Hashes RunScalar(Case const& test, Core core, bool idleSkip, FrameFunc const& frame) {
+    Chip8 chip;
+    chip.SetCore(core);
+    chip.SetIdleSkip(idleSkip);
+    chip.LoadROM(test.rom.data(), test.rom.size());
+    chip.Seed(test.seed);
+
+    Hashes hashes;
+    for (unsigned int f = 0; f < FRAMES; ++f) {
+        chip.SetKeys(KeysAt(test, f));
+        frame(chip, test.cyclesPerFrame);
+        chip.TickTimers();
+        hashes.push_back(chip.StateHash());
+    }
+    return hashes;
+}
+
+static unsigned int failures = 0;
+
+static void Check(char const* engine, Case const& test, Hashes const& actual, Hashes const& expected) {
+    for (size_t f = 0; f < expected.size(); ++f) {
+        if (actual[f] != expected[f]) {
+            std::cout << "FAIL " << engine << " seed " << test.seed << " ipf " << test.cyclesPerFrame
+                      << ": frame " << f << " state " << std::hex << std::setfill('0') << std::setw(16) << actual[f]
+                      << ", expected " << std::setw(16) << expected[f] << std::dec << "\n";
+            ++failures;
+            return;
+        }
+    }
+}
+
+static void RunPlain(Chip8& chip, unsigned int cycles) {
+    chip.Run(cycles);
+}
+
+// Every frame continues on a fresh machine loaded from a snapshot
+static void RunSaveLoad(Chip8& chip, unsigned int cycles) {
+    Chip8State state;
+    chip.SaveState(state);
+    Chip8 fresh;
+    fresh.SetCore(chip.GetCore());
+    fresh.LoadState(state);
+    chip = fresh;
+    chip.Run(cycles);
+}
+
+// Where a frame switches from translated code to the interpreter, varied
+// so either side ends up doing a given store
+static unsigned int SplitAt(Case const& test, unsigned int call, unsigned int cycles) {
+    return static_cast<unsigned int>(Chip8::SeedState(test.seed * FRAMES + call) % (cycles + 1));
+}
+
+static void CompareScalar(Case const& test, Hashes const& expected, Jit& jit) {
+    Check("table", test, RunScalar(test, Core::Table, false, RunPlain), expected);
+    Check("cached", test, RunScalar(test, Core::Cached, false, RunPlain), expected);
+    Check("switch+idle", test, RunScalar(test, Core::Switch, true, RunPlain), expected);
+    Check("table+idle", test, RunScalar(test, Core::Table, true, RunPlain), expected);
+    Check("cached+idle", test, RunScalar(test, Core::Cached, true, RunPlain), expected);
+    Check("cycle", test, RunScalar(test, Core::Switch, false, [](Chip8& chip, unsigned int cycles) {
+        for (unsigned int i = 0; i < cycles; ++i) {
+            chip.Cycle();
+        }
+    }), expected);
+    Check("saveload", test, RunScalar(test, Core::Switch, true, RunSaveLoad), expected);
+    Check("jit", test, RunScalar(test, Core::Switch, false, [&](Chip8& chip, unsigned int cycles) {
+        jit.Run(chip, cycles);
+    }), expected);
+
+    // Stores made by the interpreter between JIT calls must reach the JIT
+    unsigned int calls = 0;
+    Check("jit+interpreter", test, RunScalar(test, Core::Switch, false, [&](Chip8& chip, unsigned int cycles) {
+        unsigned int split = SplitAt(test, calls++, cycles);
+        jit.Run(chip, split);
+        chip.Run(cycles - split);
+    }), expected);
+}
+
+// Each lane runs its own seed and keys, and one lane per frame goes
+// through a SaveState/LoadState round trip
+static void CompareBatch(Case const& test) {
+    std::vector<Case> lanes(BATCH_LANES, test);
+    Chip8Batch batch(BATCH_LANES);
+    batch.LoadROM(test.rom.data(), test.rom.size());
+
+    std::vector<Hashes> expected;
+    for (unsigned int lane = 0; lane < BATCH_LANES; ++lane) {
+        lanes[lane].seed = test.seed + lane;
+        batch.Seed(lane, lanes[lane].seed);
+        expected.push_back(RunScalar(lanes[lane], Core::Switch, false, RunPlain));
+    }
+
+    std::vector<Hashes> actual(BATCH_LANES);
+    for (unsigned int f = 0; f < FRAMES; ++f) {
+        Chip8State state;
+        batch.SaveState(f % BATCH_LANES, state);
+        batch.LoadState(f % BATCH_LANES, state);
+
+        for (unsigned int lane = 0; lane < BATCH_LANES; ++lane) {
+            batch.SetKeys(lane, KeysAt(lanes[lane], f));
+        }
+        batch.Run(test.cyclesPerFrame);
+        batch.TickTimers();
+
+        for (unsigned int lane = 0; lane < BATCH_LANES; ++lane) {
+            actual[lane].push_back(batch.StateHash(lane));
+        }
+    }
+
+    for (unsigned int lane = 0; lane < BATCH_LANES; ++lane) {
+        Check("batch", lanes[lane], actual[lane], expected[lane]);
+    }
+}
+
+static void CompareAot(Case const& test, Hashes const& expected) {
+    AotRunner runner(chip8AotProgram);
+    Check("aot", test, RunScalar(test, Core::Switch, false, [&](Chip8& chip, unsigned int cycles) {
+        runner.Run(chip, cycles);
+    }), expected);
+
+    AotRunner mixed(chip8AotProgram);
+    unsigned int calls = 0;
+    Check("aot+interpreter", test, RunScalar(test, Core::Switch, false, [&](Chip8& chip, unsigned int cycles) {
+        unsigned int split = SplitAt(test, calls++, cycles);
+        mixed.Run(chip, split);
+        chip.Run(cycles - split);
+    }), expected);
+}
+
+// Sixteen nested calls leave sp at STACK_LEVELS, which is a legal state
+// and must survive a snapshot
+static void CheckFullStack() {
+    std::vector<uint8_t> rom;
+    for (unsigned int call = 1; call <= STACK_LEVELS; ++call) {
+        uint16_t target = static_cast<uint16_t>(START_ADDRESS + 2 * call);
+        rom.push_back(static_cast<uint8_t>(0x20 | (target >> 8)));
+        rom.push_back(static_cast<uint8_t>(target));
+    }
+    rom.push_back(0x00);
+    rom.push_back(0xEE);
+
+    Chip8 chip;
+    chip.LoadROM(rom.data(), rom.size());
+    chip.Seed(1);
+    chip.Run(STACK_LEVELS);
+
+    Chip8State state;
+    chip.SaveState(state);
+    if (state.sp != STACK_LEVELS) {
+        std::cout << "FAIL full stack: sp " << static_cast<int>(state.sp) << " after " << STACK_LEVELS << " calls\n";
+        ++failures;
+        return;
+    }
+
+    Chip8 loaded;
+    loaded.LoadState(state);
+    Chip8Batch batch(1);
+    batch.LoadROM(rom.data(), rom.size());
+    batch.LoadState(0, state);
+
+    chip.Run(100);
+    loaded.Run(100);
+    batch.Run(100);
+
+    if (loaded.StateHash() != chip.StateHash() || loaded.Diagnostics(Diag::StackUnderflow) != 0) {
+        std::cout << "FAIL full stack: Chip8 LoadState at sp " << STACK_LEVELS << " diverged\n";
+        ++failures;
+    }
+    if (batch.StateHash(0) != chip.StateHash() || batch.Diagnostics(0, Diag::StackUnderflow) != 0) {
+        std::cout << "FAIL full stack: Chip8Batch LoadState at sp " << STACK_LEVELS << " diverged\n";
+        ++failures;
+    }
+}
+
+// Two forks of one machine each patch the same instruction with their own
+// random byte, so they have the same code epoch and write count but
+// different code. Assigning one over the other must not keep running
+// blocks compiled for the first.
+static void CheckForkedJit(Jit& jit) {
+    std::vector<uint8_t> rom = {
+        0xA2, 0x0C,     // 200: I = 20C
+        0xC1, 0xFF,     // 202: V1 = random
+        0x60, 0x72,     // 204: V0 = 0x72
+        0xF1, 0x55,     // 206: store V0, V1 over 20C
+        0x12, 0x0C,     // 208: jump 20C
+        0x00, 0x00,
+        0x72, 0x00,     // 20C: V2 += V1 from the store
+        0x73, 0x01,     // 20E: V3 += 1
+        0x12, 0x0C,     // 210: jump 20C
+    };
+
+    Chip8 parent;
+    parent.LoadROM(rom.data(), rom.size());
+    Chip8 chip = parent;
+    Chip8 sibling = parent;
+    chip.Seed(1);
+    sibling.Seed(2);
+    chip.Run(4);
+    sibling.Run(4);
+    jit.Run(chip, 100);
+
+    Chip8 expected = sibling;
+    expected.Run(100);
+
+    chip = sibling;
+    jit.Flush();
+    jit.Run(chip, 100);
+
+    if (chip.StateHash() != expected.StateHash()) {
+        std::cout << "FAIL jit fork: blocks compiled for the replaced machine still ran\n";
+        ++failures;
+    }
+}
+
+int main() {
+    Logger::Instance().SetLevel(Severity::Off);
+
+    // One JIT shared by every machine, so its cache also sees owners change
+    Jit jit;
+
+    for (unsigned int n = 0; n < ROM_COUNT; ++n) {
+        Case test{RomGenerator(n).Generate(), 1000 + n, 8 + n % 48};
+        Hashes expected = RunScalar(test, Core::Switch, false, RunPlain);
+        CompareScalar(test, expected, jit);
+        CompareBatch(test);
+    }
+
+    std::vector<uint8_t> aotRom = RomGenerator(CHIP8_AOT_TEST_SEED).Generate();
+    for (unsigned int n = 0; n < AOT_SEEDS; ++n) {
+        Case test{aotRom, 5000 + n, 8 + n % 48};
+        CompareAot(test, RunScalar(test, Core::Switch, false, RunPlain));
+    }
+
+    CheckForkedJit(jit);
+    CheckFullStack();
+
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << ": " << ROM_COUNT << " generated ROMs, "
+              << AOT_SEEDS << " AOT runs, " << failures << " divergences\n";
+    return failures == 0 ? 0 : EXIT_FAILURE;
+}
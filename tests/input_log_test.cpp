@@ -0,0 +1,162 @@
+#include "chip.hpp"
+#include "input_log.hpp"
+#include "log.hpp"
+#include "rom_gen.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Records a session with key changes at instruction offsets inside frames,
+// saves and reloads the log, and replays it into a fresh machine, which
+// must match the recording's state hash after every frame. Cut or damaged
+// log files must fail to load.
+
+const uint64_t FRAMES = 400;
+const uint32_t CYCLES_PER_FRAME = 31;
+const uint64_t SEED = 42;
+char const* const LOG_FILE = "input_log_test.c8in";
+
+static unsigned int failures = 0;
+
+static void Fail(char const* what, uint64_t where) {
+    std::cout << "FAIL " << what << " at " << where << "\n";
+    ++failures;
+}
+
+static void WriteBytes(std::vector<char> const& bytes) {
+    std::ofstream file(LOG_FILE, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+}
+
+static std::vector<uint64_t> Record(std::vector<uint8_t> const& rom, InputLog& log) {
+    Chip8 chip;
+    chip.LoadROM(rom.data(), rom.size());
+    chip.Seed(SEED);
+    log.seed = SEED;
+    log.cyclesPerFrame = CYCLES_PER_FRAME;
+
+    std::vector<uint64_t> hashes;
+    for (uint64_t frame = 0; frame < FRAMES; ++frame) {
+        // Up to three changes, at offsets anywhere from the first
+        // instruction to after the last, sometimes two at once
+        uint64_t bits = Chip8::SeedState(frame);
+        std::vector<uint32_t> offsets;
+        for (unsigned int i = 0; i < bits % 4; ++i) {
+            offsets.push_back(static_cast<uint32_t>((bits >> (8 + 8 * i)) % (CYCLES_PER_FRAME + 1)));
+        }
+        std::sort(offsets.begin(), offsets.end());
+
+        uint32_t done = 0;
+        for (unsigned int i = 0; i < offsets.size(); ++i) {
+            chip.Run(offsets[i] - done);
+            done = offsets[i];
+
+            uint16_t keys = (bits >> (40 + i)) & 1 ? static_cast<uint16_t>(bits >> (16 + 4 * i)) : 0;
+            chip.SetKeys(keys);
+            log.Record(frame, done, keys);
+        }
+        chip.Run(CYCLES_PER_FRAME - done);
+        chip.TickTimers();
+        hashes.push_back(chip.StateHash());
+    }
+
+    log.frames = FRAMES;
+    return hashes;
+}
+
+// Replays a recorded session from a saved log and checks every frame;
+// returns the saved file's bytes
+static std::vector<char> CheckReplay(std::vector<uint8_t> const& rom, char const* name) {
+    InputLog recorded;
+    std::vector<uint64_t> expected = Record(rom, recorded);
+
+    InputLog log;
+    if (!recorded.Save(LOG_FILE) || !log.Load(LOG_FILE)) {
+        Fail(name, 0);
+        return {};
+    }
+
+    if (log.seed != recorded.seed || log.cyclesPerFrame != recorded.cyclesPerFrame || log.frames != recorded.frames
+        || log.events.size() != recorded.events.size()) {
+        Fail(name, log.events.size());
+    } else {
+        for (size_t i = 0; i < log.events.size(); ++i) {
+            InputEvent const& a = log.events[i];
+            InputEvent const& b = recorded.events[i];
+            if (a.frame != b.frame || a.instruction != b.instruction || a.keys != b.keys) {
+                Fail(name, i);
+                break;
+            }
+        }
+    }
+
+    Chip8 chip;
+    chip.LoadROM(rom.data(), rom.size());
+    chip.Seed(log.seed);
+    size_t cursor = 0;
+    for (uint64_t frame = 0; frame < log.frames; ++frame) {
+        log.PlayFrame(chip, frame, cursor, [&](uint64_t count) { chip.Run(count); });
+        if (chip.StateHash() != expected[frame]) {
+            Fail(name, frame);
+            break;
+        }
+    }
+
+    std::ifstream in(LOG_FILE, std::ios::binary);
+    return std::vector<char>((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+int main() {
+    Logger::Instance().SetLevel(Severity::Off);
+
+    // Samples key 0 every few instructions, so replaying a change even one
+    // instruction early or late shows in V1
+    std::vector<uint8_t> sampler = {
+        0xE0, 0x9E,     // 200: skip if key V0 held
+        0x71, 0x01,     // 202: V1 += 1
+        0x72, 0x01,     // 204: V2 += 1
+        0x12, 0x00,     // 206: jump 200
+    };
+    CheckReplay(sampler, "replay of the key sampler");
+    std::vector<char> bytes = CheckReplay(RomGenerator(11).Generate(), "replay of a generated ROM");
+    if (bytes.size() < 6) {
+        Fail("saved log size", bytes.size());
+        return EXIT_FAILURE;
+    }
+
+    // Every shorter prefix, a bad magic or version, and trailing bytes
+    InputLog rejected;
+    for (size_t size = 0; size < bytes.size(); ++size) {
+        WriteBytes(std::vector<char>(bytes.begin(), bytes.begin() + size));
+        if (rejected.Load(LOG_FILE)) {
+            Fail("truncated log loaded", size);
+            break;
+        }
+    }
+
+    for (size_t offset : {0, 4}) {
+        std::vector<char> corrupt = bytes;
+        corrupt[offset] ^= 0x40;
+        WriteBytes(corrupt);
+        if (rejected.Load(LOG_FILE)) {
+            Fail("corrupt header loaded", offset);
+        }
+    }
+
+    std::vector<char> longer = bytes;
+    longer.push_back(0);
+    WriteBytes(longer);
+    if (rejected.Load(LOG_FILE)) {
+        Fail("log with trailing data loaded", longer.size());
+    }
+
+    std::remove(LOG_FILE);
+
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << ": " << failures << " failed checks\n";
+    return failures == 0 ? 0 : EXIT_FAILURE;
+}
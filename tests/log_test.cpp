@@ -0,0 +1,94 @@
+#include "chip.hpp"
+#include "log.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Floods single diagnostic sites and checks what the logger lets through
+// against the rate limit, the per-machine counters and the logger's own
+// suppressed counts.
+
+static unsigned int failures = 0;
+
+static void Expect(char const* what, uint64_t actual, uint64_t expected) {
+    if (actual != expected) {
+        std::cout << "FAIL " << what << ": " << actual << ", expected " << expected << "\n";
+        ++failures;
+    }
+}
+
+// Lines written to output so far that start with prefix
+static uint64_t CountLines(FILE* output, char const* prefix) {
+    Logger::Instance().Flush();
+    rewind(output);
+
+    uint64_t count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), output)) {
+        count += strncmp(line, prefix, strlen(prefix)) == 0 ? 1 : 0;
+    }
+    fseek(output, 0, SEEK_END);
+    return count;
+}
+
+int main() {
+    Logger& logger = Logger::Instance();
+    FILE* output = tmpfile();
+    if (!output) {
+        std::cerr << "ERROR: Failed to create a temporary file\n";
+        return EXIT_FAILURE;
+    }
+    logger.SetOutput(output);
+    logger.SetLevel(Severity::Info);
+
+    // A lone 00EE underflows and resets on every instruction
+    const uint64_t FLOOD = 1000;
+    std::vector<uint8_t> rom = {0x00, 0xEE};
+    Chip8 chip;
+    chip.LoadROM(rom.data(), rom.size());
+    chip.Run(FLOOD);
+
+    Expect("underflow counter", chip.Diagnostics(Diag::StackUnderflow), FLOOD);
+    for (unsigned int i = 0; i < DIAG_COUNT; ++i) {
+        Diag diag = static_cast<Diag>(i);
+        if (diag != Diag::StackUnderflow) {
+            Expect(DiagName(diag), chip.Diagnostics(diag), 0);
+        }
+    }
+    Expect("underflow lines", CountLines(output, "Stack underflow"), LOG_RATE_LIMIT);
+    Expect("underflow suppressed", logger.Suppressed(Diag::StackUnderflow), FLOOD - LOG_RATE_LIMIT);
+
+    // Another site has its own limit, untouched by the flood above
+    for (uint64_t i = 0; i < 50; ++i) {
+        logger.Report(Diag::IndexOverflow, static_cast<uint16_t>(i));
+    }
+    Expect("index overflow lines", CountLines(output, "Index register overflow"), LOG_RATE_LIMIT);
+    Expect("index overflow suppressed", logger.Suppressed(Diag::IndexOverflow), 50 - LOG_RATE_LIMIT);
+
+    // Below the level nothing is written or counted as suppressed
+    logger.SetLevel(Severity::Error);
+    for (uint64_t i = 0; i < 50; ++i) {
+        logger.Report(Diag::SpriteOutOfBounds, static_cast<uint16_t>(i));
+    }
+    Expect("sprite lines below level", CountLines(output, "DRAW:"), 0);
+    Expect("sprite suppressed below level", logger.Suppressed(Diag::SpriteOutOfBounds), 0);
+
+    // With output off entries are consumed without being written
+    logger.SetOutput(nullptr);
+    for (uint64_t i = 0; i < 5; ++i) {
+        logger.Report(Diag::StackOverflow, static_cast<uint16_t>(i));
+    }
+    logger.Flush();
+    logger.SetOutput(output);
+    Expect("overflow lines with output off", CountLines(output, "STACK OVERFLOW"), 0);
+
+    Expect("dropped", logger.Dropped(), 0);
+    logger.SetOutput(stderr);
+    fclose(output);
+
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << ": " << failures << " failed checks\n";
+    return failures == 0 ? 0 : EXIT_FAILURE;
+}
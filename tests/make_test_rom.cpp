@@ -0,0 +1,24 @@
+#include "rom_gen.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Writes the generated ROM for one seed, so chip8-aot can translate it at
+// build time
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <Seed> <Out.ch8>\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::vector<uint8_t> rom = RomGenerator(std::stoull(argv[1])).Generate();
+
+    std::ofstream file(argv[2], std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "ERROR: Failed to open " << argv[2] << " for writing\n";
+        std::exit(EXIT_FAILURE);
+    }
+    file.write(reinterpret_cast<char const*>(rom.data()), rom.size());
+    return file.good() ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,131 @@
+#include "chip.hpp"
+#include "log.hpp"
+#include "rewind.hpp"
+#include "rom_gen.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Pushes a few hundred frames of a generated ROM into rewind buffers small
+// enough to evict, then checks every depth still held, including the
+// oldest frame and rewinding past it, against the state hash the machine
+// had at that frame. Rewinding and playing on must keep working too.
+
+const unsigned int CYCLES_PER_FRAME = 23;
+const uint64_t MAX_FRAMES = 5000;
+
+static unsigned int failures = 0;
+
+static void Fail(char const* what, size_t budget, unsigned int interval, uint64_t detail) {
+    std::cout << "FAIL " << what << " (budget " << budget << ", keyframe interval " << interval
+              << "): " << detail << "\n";
+    ++failures;
+}
+
+struct Session {
+    Chip8 chip;
+    RewindBuffer buffer;
+    std::vector<uint64_t> history;    // state hash of every frame on the current timeline
+    size_t budget;
+    unsigned int interval;
+    uint64_t frame{};
+
+    Session(size_t budgetBytes, unsigned int keyframeInterval)
+        : buffer(budgetBytes, keyframeInterval), budget(budgetBytes), interval(keyframeInterval)
+    {
+        std::vector<uint8_t> rom = RomGenerator(5).Generate();
+        chip.LoadROM(rom.data(), rom.size());
+        chip.Seed(5);
+    }
+
+    void Play(unsigned int frames) {
+        for (unsigned int i = 0; i < frames; ++i, ++frame) {
+            chip.SetKeys((frame / 16) % 3 == 0 ? static_cast<uint16_t>(Chip8::SeedState(frame)) : 0);
+            chip.Run(CYCLES_PER_FRAME);
+            chip.TickTimers();
+            buffer.Push(chip);
+            history.push_back(chip.StateHash());
+        }
+    }
+
+    // Every depth the buffer holds, each on a copy so nothing is lost
+    void CheckAllDepths() {
+        if (buffer.Frames() == 0 || buffer.Frames() > history.size()) {
+            Fail("frames held", budget, interval, buffer.Frames());
+            return;
+        }
+
+        for (size_t depth = 0; depth < buffer.Frames(); ++depth) {
+            RewindBuffer copy = buffer;
+            Chip8 restored;
+            if (copy.Rewind(restored, static_cast<unsigned int>(depth)) != depth
+                || restored.StateHash() != history[history.size() - 1 - depth]) {
+                Fail("rewind to a held frame", budget, interval, depth);
+                return;
+            }
+        }
+    }
+
+    void Rewind(unsigned int frames) {
+        size_t held = buffer.Frames();
+        unsigned int expected = static_cast<unsigned int>(frames < held ? frames : held - 1);
+
+        if (buffer.Rewind(chip, frames) != expected) {
+            Fail("frames rewound", budget, interval, frames);
+        }
+        history.resize(history.size() - expected);
+        if (chip.StateHash() != history.back() || buffer.Frames() != held - expected) {
+            Fail("state after rewind", budget, interval, frames);
+        }
+    }
+};
+
+static void CheckBudget(size_t budget, unsigned int interval) {
+    Session session(budget, interval);
+
+    // Small deltas can take longer than 300 frames to fill the ring
+    session.Play(300);
+    while (session.buffer.Frames() == session.history.size() && session.frame < MAX_FRAMES) {
+        session.Play(100);
+    }
+    if (session.buffer.Frames() == session.history.size()) {
+        Fail("nothing evicted", budget, interval, session.buffer.Frames());
+    }
+    if (session.buffer.BytesUsed() > std::max(budget, 4 * sizeof(Chip8State))) {
+        Fail("bytes over budget", budget, interval, session.buffer.BytesUsed());
+    }
+    session.CheckAllDepths();
+
+    // Rewinding then playing on overwrites the newer frames, across
+    // keyframes and further evictions
+    for (unsigned int frames : {1u, 7u, 10u, 23u, 61u}) {
+        session.Rewind(frames);
+        session.CheckAllDepths();
+        session.Play(50);
+        session.CheckAllDepths();
+    }
+
+    // Past the oldest frame still held stops at that frame
+    session.Rewind(100000);
+    if (session.buffer.Frames() != 1) {
+        Fail("frames after rewinding past the oldest", budget, interval, session.buffer.Frames());
+    }
+    session.Play(100);
+    session.CheckAllDepths();
+}
+
+int main() {
+    Logger::Instance().SetLevel(Severity::Off);
+
+    // Groups that fit several times, only keyframes, and with the smallest
+    // ring one group outgrowing it, so making room evicts a delta's base
+    CheckBudget(32 << 10, 10);
+    CheckBudget(20 << 10, 60);
+    CheckBudget(64 << 10, 1);
+    CheckBudget(0, 1000);
+
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << ": " << failures << " failed checks\n";
+    return failures == 0 ? 0 : EXIT_FAILURE;
+}
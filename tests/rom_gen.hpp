@@ -0,0 +1,114 @@
+#pragma once
+#include "chip.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Seeded generator of test ROMs. Unlike random bytes, which mostly reset
+// on invalid opcodes within a few instructions, these are mostly valid
+// instructions: loops and calls within the program, skips, key and timer
+// polls, draws, and stores into both a data area and the program itself.
+// Every ROM starts with the same self-modifying prologue.
+class RomGenerator {
+
+    public:
+        explicit RomGenerator(uint64_t seed) : state(Chip8::SeedState(seed)) {}
+
+        std::vector<uint8_t> Generate() {
+            // A loop that keeps rewriting the first instruction of the
+            // subroutine it calls, so translated code sees stores into a
+            // block it already compiled, from its own steps or the
+            // interpreter's. It runs 32 times and falls through.
+            std::vector<uint16_t> ops = {
+                0x6072,     // 200: V0 = 0x72
+                0x6E20,     // 202: VE = 32
+                0xA212,     // 204: I = 212
+                0x2212,     // 206: call 212
+                0xF155,     // 208: store V0, V1 over 212
+                0x7EFF,     // 20A: VE -= 1
+                0x3E00,     // 20C: skip if VE == 0
+                0x1204,     // 20E: jump 204
+                0x1218,     // 210: jump past the subroutine
+                0x7200,     // 212: V2 += V1 from the last store
+                0x7103,     // 214: V1 += 3
+                0x00EE,     // 216: return
+            };
+            unsigned int length = static_cast<unsigned int>(ops.size()) + 48 + Below(96);
+
+            while (ops.size() < length) {
+                unsigned int here = static_cast<unsigned int>(ops.size());
+                unsigned int kind = Below(100);
+                uint16_t x = static_cast<uint16_t>(Below(16) << 8);
+                uint16_t y = static_cast<uint16_t>(Below(16) << 4);
+                uint16_t kk = static_cast<uint16_t>(Below(256));
+
+                if (kind < 14) {
+                    ops.push_back(0x6000 | x | kk);
+                } else if (kind < 24) {
+                    ops.push_back(0x7000 | x | kk);
+                } else if (kind < 36) {
+                    static uint16_t const alu[] = {0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0xE};
+                    ops.push_back(0x8000 | x | y | alu[Below(9)]);
+                } else if (kind < 46) {
+                    static uint16_t const skips[] = {0x3000, 0x4000, 0x5000, 0x9000};
+                    uint16_t skip = skips[Below(4)];
+                    ops.push_back(skip | x | (skip == 0x5000 || skip == 0x9000 ? y : kk));
+                } else if (kind < 52) {
+                    ops.push_back(0x1000 | Address(length));
+                } else if (kind < 56) {
+                    ops.push_back(0x2000 | Address(length));
+                } else if (kind < 60) {
+                    ops.push_back(0x00EE);
+                } else if (kind < 66) {
+                    // I into the data area, or into the program so stores patch code
+                    ops.push_back(0xA000 | (Below(4) == 0 ? Address(length) : 0x400 + Below(0x100)));
+                } else if (kind < 72) {
+                    ops.push_back(0xD000 | x | y | (1 + Below(15)));
+                } else if (kind < 73) {
+                    ops.push_back(0x00E0);
+                } else if (kind < 77) {
+                    ops.push_back(0xC000 | x | kk);
+                } else if (kind < 81) {
+                    ops.push_back((Below(2) ? 0xE09E : 0xE0A1) | x);
+                } else if (kind < 93) {
+                    static uint16_t const fx[] = {0x07, 0x15, 0x18, 0x1E, 0x29, 0x33, 0x55, 0x65};
+                    ops.push_back(0xF000 | x | fx[Below(8)]);
+                } else if (kind < 94) {
+                    ops.push_back(0xF00A | x);
+                } else if (kind < 97) {
+                    // Delay-timer poll, the loop idle skipping fast-forwards
+                    ops.push_back(0xF007 | x);
+                    ops.push_back(0x3000 | x);
+                    ops.push_back(0x1000 | static_cast<uint16_t>(START_ADDRESS + 2 * here));
+                } else if (kind < 98) {
+                    ops.push_back(0xB000 | Address(length));
+                } else {
+                    ops.push_back(static_cast<uint16_t>(Next()));
+                }
+            }
+
+            std::vector<uint8_t> rom;
+            for (uint16_t op : ops) {
+                rom.push_back(static_cast<uint8_t>(op >> 8));
+                rom.push_back(static_cast<uint8_t>(op));
+            }
+            return rom;
+        }
+
+        unsigned int Below(unsigned int bound) { return static_cast<unsigned int>(Next() % bound); }
+
+    private:
+        uint64_t state;
+
+        // xorshift64*, as the core uses
+        uint64_t Next() {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return (state * 2685821657736338717ull) >> 32;
+        }
+
+        uint16_t Address(unsigned int length) {
+            return static_cast<uint16_t>(START_ADDRESS + 2 * Below(length));
+        }
+};
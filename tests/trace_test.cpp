@@ -0,0 +1,221 @@
+#include "chip.hpp"
+#include "log.hpp"
+#include "lz.hpp"
+#include "rom_gen.hpp"
+#include "trace.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// Round-trips the LZ codec over lengths around its 15 + 255 extension
+// bytes, then traces a generated ROM, with timer ticks and state restores
+// between instructions, and reads the trace back from the start and from
+// seeks into every chunk, comparing each record with the live machine.
+
+const uint64_t TRACE_INSTRUCTIONS = 60000;
+const unsigned int CYCLES_PER_FRAME = 37;
+const uint64_t SEEK_STRIDE = 1777;
+const uint64_t SEEK_READ = 3000;
+
+static unsigned int failures = 0;
+
+static void Fail(char const* what, uint64_t where) {
+    std::cout << "FAIL " << what << " at " << where << "\n";
+    ++failures;
+}
+
+static std::vector<uint8_t> RandomBytes(uint64_t& state, size_t size) {
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& byte : bytes) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        byte = static_cast<uint8_t>(state >> 56);
+    }
+    return bytes;
+}
+
+static void CheckLz(std::vector<uint8_t> const& input, char const* what) {
+    std::vector<uint8_t> packed(LzBound(input.size()));
+    size_t size = LzCompress(input.data(), input.size(), packed.data());
+    if (size > packed.size()) {
+        Fail(what, input.size());
+        return;
+    }
+
+    std::vector<uint8_t> output(input.size());
+    if (!LzDecompress(packed.data(), size, output.data(), output.size()) || output != input) {
+        Fail(what, input.size());
+        return;
+    }
+
+    // Neither a cut stream nor a wrong expected size may decode
+    if (size > 0 && LzDecompress(packed.data(), size - 1, output.data(), output.size())) {
+        Fail("LZ accepted a truncated stream", input.size());
+    }
+    std::vector<uint8_t> longer(input.size() + 1);
+    if (LzDecompress(packed.data(), size, longer.data(), longer.size())) {
+        Fail("LZ accepted a wrong raw size", input.size());
+    }
+}
+
+static void CheckLzCodec() {
+    uint64_t state = 1;
+    CheckLz({}, "LZ empty input");
+    CheckLz(RandomBytes(state, 3), "LZ input shorter than a match");
+    CheckLz(RandomBytes(state, 70000), "LZ incompressible input");
+    CheckLz(std::vector<uint8_t>(70000, 0x5A), "LZ single-byte run");
+
+    // Literal runs and matches either side of 15, 15 + 255 and 15 + 2 * 255
+    std::vector<size_t> lengths;
+    for (size_t edge : {0, 15, 270, 525}) {
+        for (size_t length = edge > 3 ? edge - 3 : 0; length <= edge + 3; ++length) {
+            lengths.push_back(length);
+        }
+    }
+
+    for (size_t literals : lengths) {
+        for (size_t match : lengths) {
+            std::vector<uint8_t> input = RandomBytes(state, literals);
+            std::vector<uint8_t> copy = input.size() >= 8 ? std::vector<uint8_t>(input.end() - 8, input.end())
+                                                         : RandomBytes(state, 8);
+            input.insert(input.end(), copy.begin(), copy.end());
+            input.insert(input.end(), match + 4, 0);
+            std::vector<uint8_t> tail = RandomBytes(state, literals % 7);
+            input.insert(input.end(), tail.begin(), tail.end());
+            CheckLz(input, "LZ length extension");
+        }
+    }
+}
+
+static TraceRegs LiveRegs(Chip8 const& chip) {
+    Chip8State state;
+    chip.SaveState(state);
+
+    TraceRegs regs{};
+    memcpy(regs.V, state.registers, sizeof(regs.V));
+    regs.index = state.index;
+    regs.sp = state.sp;
+    regs.delayTimer = state.delayTimer;
+    regs.soundTimer = state.soundTimer;
+    return regs;
+}
+
+static bool SameRegs(TraceRegs const& a, TraceRegs const& b) {
+    return memcmp(a.V, b.V, sizeof(a.V)) == 0 && a.index == b.index && a.sp == b.sp
+        && a.delayTimer == b.delayTimer && a.soundTimer == b.soundTimer;
+}
+
+// Registers after every instruction of a traced run
+static std::vector<TraceRegs> WriteTrace(char const* filename, bool compress) {
+    Chip8 chip;
+    std::vector<uint8_t> rom = RomGenerator(3).Generate();
+    chip.LoadROM(rom.data(), rom.size());
+    chip.Seed(3);
+
+    TraceWriter tracer;
+    tracer.Open(filename, compress);
+    chip.SetTracer(&tracer);
+
+    std::vector<TraceRegs> expected;
+    Chip8State saved;
+    chip.SaveState(saved);
+
+    for (uint64_t n = 0; n < TRACE_INSTRUCTIONS; ++n) {
+        chip.Cycle();
+        expected.push_back(LiveRegs(chip));
+
+        // Changes between instructions must reach the next record
+        if ((n + 1) % CYCLES_PER_FRAME == 0) {
+            chip.SetKeys(static_cast<uint16_t>(Chip8::SeedState(n)));
+            chip.TickTimers();
+        }
+        if ((n + 1) % (CYCLES_PER_FRAME * 50) == 0) {
+            chip.LoadState(saved);
+            chip.SaveState(saved);
+        } else if ((n + 1) % (CYCLES_PER_FRAME * 20) == 0) {
+            chip.SaveState(saved);
+        }
+    }
+
+    chip.SetTracer(nullptr);
+    tracer.Close();
+    return expected;
+}
+
+// Reads count records from the reader's position on, which is first
+static void CheckRecords(TraceReader& reader, std::vector<TraceRegs> const& expected, uint64_t first,
+                         uint64_t count, char const* what) {
+    TraceRecord record;
+    for (uint64_t n = first; n < first + count && n < expected.size(); ++n) {
+        if (!reader.Next(record)) {
+            Fail(what, n);
+            return;
+        }
+        if (record.instruction != n || !SameRegs(record.regs, expected[n])) {
+            Fail(what, n);
+            return;
+        }
+    }
+}
+
+static void CheckTrace(bool compress) {
+    char const* filename = compress ? "trace_test_lz.c8t" : "trace_test_raw.c8t";
+    std::vector<TraceRegs> expected = WriteTrace(filename, compress);
+
+    TraceReader reader;
+    if (!reader.Open(filename) || reader.Instructions() != expected.size()) {
+        Fail("trace open", 0);
+        return;
+    }
+    CheckRecords(reader, expected, 0, expected.size(), "trace read");
+
+    for (uint64_t from = 0; from < expected.size(); from += SEEK_STRIDE) {
+        if (!reader.Seek(from)) {
+            Fail("trace seek", from);
+            continue;
+        }
+        CheckRecords(reader, expected, from, SEEK_READ, "trace read after seek");
+    }
+    if (!reader.Seek(expected.size() - 1)) {
+        Fail("trace seek", expected.size() - 1);
+    }
+    CheckRecords(reader, expected, expected.size() - 1, 1, "trace read after seek");
+    if (reader.Seek(expected.size())) {
+        Fail("trace seek past the end succeeded", expected.size());
+    }
+
+    // Without its index the reader recovers whole chunks by scanning
+    std::ifstream in(filename, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), bytes.size() / 2);
+    out.close();
+
+    TraceReader recovered;
+    if (!recovered.Open(filename) || recovered.Instructions() == 0 || recovered.Instructions() >= expected.size()) {
+        Fail("trace recovery without index", 0);
+        return;
+    }
+    CheckRecords(recovered, expected, 0, recovered.Instructions(), "trace read without index");
+    std::remove(filename);
+}
+
+int main() {
+    Logger::Instance().SetLevel(Severity::Off);
+
+    CheckLzCodec();
+
+    if (PROFILER_COMPILED) {
+        CheckTrace(true);
+        CheckTrace(false);
+    } else {
+        std::cout << "tracing not compiled in (CHIP8_PROFILER=OFF), trace checks skipped\n";
+    }
+
+    std::cout << (failures == 0 ? "PASS" : "FAIL") << ": " << failures << " failed checks\n";
+    return failures == 0 ? 0 : EXIT_FAILURE;
+}